@@ -30,6 +30,7 @@
 
 static void _print_all_groups (cobj_book_t *book);
 static void _print_group      (cobj_book_t *book, size_t group);
+static void _write_file       (const char *path, const char *str);
 
 /************************************************************************************************************/
 /************************************************************************************************************/
@@ -83,6 +84,18 @@ main(void)
 	cobj_book_clear(book);
 	_print_all_groups(book);
 
+	/* snapshot of a mapped file whose last line has no trailing newline */
+
+	cobj_book_destroy(&book);
+	_write_file("book-lines.txt", "alpha\nbeta\ngamma");
+	book = cobj_book_create_mapped("book-lines.txt");
+	cobj_book_save(book, "book-snapshot.bin");
+	cobj_book_destroy(&book);
+	book = cobj_book_load("book-snapshot.bin");
+	_print_all_groups(book);
+	remove("book-lines.txt");
+	remove("book-snapshot.bin");
+
 	/* end */
 
 	if (cobj_book_has_failed(book))
@@ -134,3 +147,17 @@ _print_group(cobj_book_t *book, size_t group)
 
 	printf("\n");
 }
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_write_file(const char *path, const char *str)
+{
+	FILE *file;
+
+	if ((file = fopen(path, "w")))
+	{
+		fputs(str, file);
+		fclose(file);
+	}
+}
@@ -28,6 +28,7 @@
 /************************************************************************************************************/
 
 static void _print_contents (cobj_tracker_t *tracker, const char *header);
+static void _print_pairs    (cobj_tracker_t *tracker);
 
 /************************************************************************************************************/
 /************************************************************************************************************/
@@ -109,6 +110,10 @@ main(void)
 		printf("component with value %i was not found\n\n", a);
 	}
 
+	/* Iterate over the tracker with independent cursors */
+
+	_print_pairs(tracker);
+
 	/* Untrack all values */
 
 	cobj_tracker_clear(tracker);
@@ -160,3 +165,42 @@ _print_contents(cobj_tracker_t *tracker, const char *header)
 
 	printf("\n\n");
 }
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_print_pairs(cobj_tracker_t *tracker)
+{
+	cobj_tracker_cursor_t *cursor_1;
+	cobj_tracker_cursor_t *cursor_2;
+
+	printf("unique pairs of tracked components :\n");
+
+	/* Cursors are independent iterators, they can be nested or used by concurrent readers. */
+	/* Like the internal iterator, they get adjusted automatically when an element is pulled. */
+
+	cursor_1 = cobj_tracker_cursor_create(tracker);
+	cursor_2 = cobj_tracker_cursor_create(tracker);
+
+	cobj_tracker_cursor_reset(cursor_1);
+
+	while (cobj_tracker_cursor_increment(cursor_1))
+	{
+		cobj_tracker_cursor_reset(cursor_2);
+		while (cobj_tracker_cursor_increment(cursor_2))
+		{
+			if (cobj_tracker_cursor_get_offset(cursor_2) > cobj_tracker_cursor_get_offset(cursor_1))
+			{
+				printf(
+					"\t(%i, %i)",
+					*(int*)cobj_tracker_cursor_get_iteration(cursor_1),
+					*(int*)cobj_tracker_cursor_get_iteration(cursor_2));
+			}
+		}
+	}
+
+	printf("\n\n");
+
+	cobj_tracker_cursor_destroy(&cursor_1);
+	cobj_tracker_cursor_destroy(&cursor_2);
+}
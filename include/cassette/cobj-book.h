@@ -35,10 +35,15 @@ extern "C" {
  * Opaque book instance object. A book is a fancy dynamic string array / vector that can autoresize itself to
  * accomodate more words (aka C-strings). Words can be grouped to create sub-string-arrays. All words are
  * stored in a single continuous block of memory. There can't be more groups than words.
+ * By default, each word occupies a fixed size slot. Books created with cobj_book_create_packed() instead
+ * store words back to back, so that memory usage is proportional to the actual content.
  * This object holds an internal fail state boolean that can be checked with cobj_book_has_failed(). If it
  * happens to be put in a failure state due to a memory failure, any function that take this object as
  * argument will exit early with no side effects and return default values. The only 2 functions that are an
  * exception to this rule are cobj_book_destroy() and cobj_book_has_failed().
+ * Functions that take a const book never modify it, so they can be called from several threads at once as
+ * long as no other thread modifies the book at the same time. The internal iterator is part of the book,
+ * use cursors (cobj_book_cursor_t) to iterate over a book from several threads.
  */
 typedef struct _book_t cobj_book_t;
 
@@ -56,6 +61,21 @@ enum cobj_book_group_mode_t
 
 typedef enum cobj_book_group_mode_t cobj_book_group_mode_t;
 
+/**
+ * External word iterator. Unlike the book's internal iterator, cursors live outside of the book and are only
+ * read from it, so any number of them can walk the same book at the same time, including from different
+ * threads, as long as the book is not modified meanwhile. A cursor is a plain value that can be copied
+ * freely. Its fields can be read but should only be set through cobj_book_reset_cursor() and
+ * cobj_book_increment_cursor().
+ */
+struct cobj_book_cursor_t
+{
+	size_t group; /* group the cursor is set at, SIZE_MAX if locked */
+	size_t word;  /* word offset within the group, starts at 1 for the first word, 0 before it */
+};
+
+typedef struct cobj_book_cursor_t cobj_book_cursor_t;
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
 /**
@@ -73,6 +93,57 @@ typedef enum cobj_book_group_mode_t cobj_book_group_mode_t;
  */
 cobj_book_t *cobj_book_create(size_t n_alloc, size_t word_n);
 
+/**
+ * Creates a read-only book from a text file. The file is memory mapped and each non-blank line becomes a
+ * word, referenced in place without being copied. Blank lines separate groups. Line breaks ('\n' or "\r\n")
+ * are replaced by NULL terminators in a private copy-on-write mapping, so the file itself is never modified.
+ * Functions that modify a book's content have no effect on the returned instance. The maximum word size is
+ * set to the size of the longest word, terminator included.
+ * This function always returns a valid and safe-to-use or destroy object instance. If the file cannot be
+ * read, or in the case of memory allocation failure, the returned book is set in a failed state. Therefore,
+ * checking for a NULL returned value is useless, instead, use cobj_book_has_failed(). Never free() an object
+ * obtained with this function, instead use cobj_book_destroy().
+ *
+ * @param path Path of the file to load
+ *
+ * @return Created book instance object
+ */
+cobj_book_t *cobj_book_create_mapped(const char *path);
+
+/**
+ * Allocates memory and initializes a packed book instance. Unlike books created with cobj_book_create(),
+ * words are stored back to back in a single character arena, with an offset array to locate them. Each word
+ * only takes as much memory as its length and words are never truncated. Rewriting a word that is not the
+ * last one costs O(n) with n the number of bytes stored after it, because following words need to be moved.
+ * This function always returns a valid and safe-to-use or destroy object instance. Even in the case of memory
+ * allocation failure, the returned value points to an internal static book instance set in a failed state.
+ * Therefore, checking for a NULL returned value is useless, instead, use cobj_book_has_failed(). Never free()
+ * an object obtained with this function, instead use cobj_book_destroy().
+ *
+ * @param n_alloc Number of word slots to preallocate inside the newly created book, can be 0, since the book
+ *                can auto-extend its size as needed.
+ * @param word_n Byte size of the buffers returned by cobj_book_prepare_new_word()
+ *
+ * @return Created book instance object
+ */
+cobj_book_t *cobj_book_create_packed(size_t n_alloc, size_t word_n);
+
+/**
+ * Creates a book from a snapshot file written by cobj_book_save(). The word size, storage mode, groups and
+ * words of the saved book are restored exactly. Snapshots can be loaded on machines of either byte order,
+ * but not across different size_t widths.
+ * This function always returns a valid and safe-to-use or destroy object instance. If the file cannot be
+ * read, is not a valid snapshot, or in the case of memory allocation failure, the returned book is set in a
+ * failed state. Therefore, checking for a NULL returned value is useless, instead, use
+ * cobj_book_has_failed(). Never free() an object obtained with this function, instead use
+ * cobj_book_destroy().
+ *
+ * @param path Path of the snapshot file to read
+ *
+ * @return Created book instance object
+ */
+cobj_book_t *cobj_book_load(const char *path);
+
 /**
  * Gets a valid pointer to an internal book instance set in a failed state. To be used to avoid
  * leaving around uninitialized book instance pointers. Never free() an object obtained with this
@@ -100,6 +171,28 @@ void cobj_book_destroy(cobj_book_t **book);
  */
 void cobj_book_clear(cobj_book_t *book);
 
+/**
+ * Removes the duplicate words of a group, only the first occurrence of each word is kept and the remaining
+ * words keep their relative order. Words are compared through a sorted permutation of their positions, so it
+ * costs O(n log n) with n the size of the group, plus the cost of moving the words that follow the group
+ * when some get removed.
+ *
+ * @param book Book instance to interact with
+ * @param group_index Group position within the book
+ */
+void cobj_book_dedupe_group(cobj_book_t *book, size_t group_index);
+
+/**
+ * Removes a group and all its words. Following words are moved down with a single memory move and the
+ * positions of following groups are adjusted, so the cost is O(n + g) with n the number of bytes stored after
+ * the group and g the number of groups, plus O(k) with k the number of indexed words from the group onwards if
+ * the book is indexed. If the group index is out of bounds, this function has no effect.
+ *
+ * @param book Book instance to interact with
+ * @param group_index Group position within the book
+ */
+void cobj_book_erase_group(cobj_book_t *book, size_t group_index);
+
 /**
  * Removes the last group and words associated with it.
  *
@@ -114,6 +207,18 @@ void cobj_book_erase_last_group(cobj_book_t *book);
  */
 void cobj_book_erase_last_word(cobj_book_t *book);
 
+/**
+ * Removes a word from a group. If it was the only word of its group, the group is removed too, like with
+ * cobj_book_erase_group(). Otherwise, the cost is O(n + g) with n the number of bytes stored after the word
+ * and g the number of groups, plus O(k) with k the number of indexed words after it if the book is indexed. If
+ * the given indexes are out of bounds, this function has no effect.
+ *
+ * @param book Book instance to interact with
+ * @param group_index Group position within the book
+ * @param word_index Word position within the group
+ */
+void cobj_book_erase_word(cobj_book_t *book, size_t group_index, size_t word_index);
+
 /**
  * After the book's iterator has been reset with cobj_book_reset_iterator(), the words returned by
  * cobj_book_get_iteration() are not accessible until this function is called at least once. Each subsequent
@@ -136,6 +241,36 @@ void cobj_book_erase_last_word(cobj_book_t *book);
  */
 bool cobj_book_increment_iterator(cobj_book_t *book);
 
+/**
+ * Inserts a new group made of a single word before a given group. Following words are moved up with a single
+ * memory move and the positions of following groups are adjusted, so the cost is O(n + g) with n the number of
+ * bytes stored after the insertion point and g the number of groups, plus O(k) with k the number of indexed
+ * words after the insertion point if the book is indexed. If str is NULL or group_index is greater than the
+ * number of groups, this function has no effect. A group_index equal to the number of groups appends the new
+ * group at the end of the book. Like in cobj_book_write_new_word(), the word is truncated to the book's
+ * maximum word size unless the book is packed.
+ *
+ * @param book Book instance to interact with
+ * @param str C-string to write into the book
+ * @param group_index Position of the new group within the book
+ */
+void cobj_book_insert_group(cobj_book_t *book, const char *str, size_t group_index);
+
+/**
+ * Inserts a new word before a given word of a group. Following words are moved up with a single memory move
+ * and the positions of following groups are adjusted, so the cost is O(n + g) with n the number of bytes
+ * stored after the insertion point and g the number of groups, plus O(k) with k the number of indexed words
+ * after the insertion point if the book is indexed. If str is NULL or the given indexes are out of bounds, this function has no effect. A word_index
+ * equal to the size of the group appends the new word at the end of the group. Like in
+ * cobj_book_write_new_word(), the word is truncated to the book's maximum word size unless the book is packed.
+ *
+ * @param book Book instance to interact with
+ * @param str C-string to write into the book
+ * @param group_index Group position within the book
+ * @param word_index Position of the new word within the group
+ */
+void cobj_book_insert_word(cobj_book_t *book, const char *str, size_t group_index, size_t word_index);
+
 /**
  * Blocks the internal iterator so that cobj_book_increment_iterator() will fail and return false until the
  * iterator is reset with cobj_book_reset_iterator().
@@ -153,7 +288,8 @@ void cobj_book_lock_iterator(cobj_book_t *book);
  * write_new_word() when reading bytes from a stream to avoid needing extra read / write operations.
  * Exceptionally, in case of failure (due to a memory issue or if the given book was already in a failed
  * state, NULL can be returned. It is also the responsibility of the caller to respect the buffer's size when
- * writing to it.
+ * writing to it. The returned buffer starts with a '\0' terminator. In packed books, the unused part of the
+ * buffer is given back on the next word addition, so its content should be written before that.
  *
  * Example, instead of this :
  *
@@ -178,6 +314,18 @@ void cobj_book_lock_iterator(cobj_book_t *book);
  */
 char *cobj_book_prepare_new_word(cobj_book_t *book, cobj_book_group_mode_t group_mode);
 
+/**
+ * Preallocates enough memory to hold at least a given number of words and groups, so that no reallocation
+ * happens until these amounts are exceeded. The word and group arrays grow independently, so a book that
+ * holds many words in few groups does not need as many group slots as word slots. This function never
+ * shrinks the book, use cobj_book_trim() for that.
+ *
+ * @param book Book instance to interact with
+ * @param n_words Minimum number of word slots
+ * @param n_groups Minimum number of group slots
+ */
+void cobj_book_reserve(cobj_book_t *book, size_t n_words, size_t n_groups);
+
 /**
  * Resets an internal word iterator to the beginning of a given group. Before accessing a word,
  * cobj_book_increment_iterator() should be called at least once.
@@ -199,7 +347,8 @@ void cobj_book_reset_iterator(cobj_book_t *book, size_t group_index);
 
 /**
  * Replaces the n-th word value from the n-th group with a new C-string value. If str is NULL, or the given
- * indexes are out of bound, then this function has no effect.
+ * indexes are out of bound, then this function has no effect. In packed books, the word is resized to fit the
+ * new value instead of being truncated.
  *
  * @param book Book instance to interact with
  * @param str C-string to set the new value to
@@ -208,6 +357,67 @@ void cobj_book_reset_iterator(cobj_book_t *book, size_t group_index);
  */
 void cobj_book_rewrite_word(cobj_book_t *book, const char *str, size_t group_index, size_t word_index);
 
+/**
+ * Enables or disables the book's word index. When enabled, the book maintains a hash index of its words, keyed
+ * by content only, so that cobj_book_find_word() answers in O(d) on average with d the number of copies of the
+ * word in the whole book, instead of comparing every word of the group. The index is built over existing words
+ * when enabled, and kept up to date as words and groups are written, inserted, rewritten and erased, at the
+ * cost of extra memory and slower writes. Words moving to another group are never rehashed. Disabling it frees
+ * its memory. Indexing is disabled by default. Unlike other modifying functions, this one also works on mapped
+ * books.
+ *
+ * @param book Book instance to interact with
+ * @param indexing Enable or disable the index
+ */
+void cobj_book_set_indexing(cobj_book_t *book, bool indexing);
+
+/**
+ * Sorts the words of every group in byte order with strcmp(). Groups keep their position and their words.
+ * Each group is sorted as a permutation of word positions, groups being handed out to a pool of threads,
+ * then all words are moved once into their final order. Equal words keep their relative order. Pool threads
+ * are started by the first sort that needs them and kept asleep until the book is destroyed, so that later
+ * sorts only wake them.
+ *
+ * @param book Book instance to interact with
+ * @param n_threads Number of threads to sort with, the calling thread included, 0 and 1 sort on the calling
+ *                  thread only
+ */
+void cobj_book_sort(cobj_book_t *book, size_t n_threads);
+
+/**
+ * Sorts the words of a given group in byte order with strcmp(). Equal words keep their relative order.
+ *
+ * @param book Book instance to interact with
+ * @param group_index Group position within the book
+ */
+void cobj_book_sort_group(cobj_book_t *book, size_t group_index);
+
+/**
+ * Splits a buffer into words and groups and appends them to the book. Words are the runs of bytes that are
+ * neither word nor group separators. A group separator, on top of separating words, makes the next word
+ * start a new group. NULL bytes always separate words. The buffer is scanned for separators with vector
+ * instructions when available, then all new words are appended with a single memory reservation.
+ * Input can be streamed in successive chunks: a word or group that is cut at the end of a chunk continues
+ * into the next call. The first word of a stream always starts a new group. A stream ends when this
+ * function is called with a NULL buffer, or when any other function adds or removes words. Like in
+ * cobj_book_write_new_word(), words are truncated to the book's maximum word size unless the book is packed.
+ *
+ * Usage example :
+ *
+ *	while ((n = fread(buf, 1, sizeof(buf), stream)) > 0)
+ *	{
+ *		cobj_book_tokenize(book, buf, n, " \t", "\n");
+ *	}
+ *	cobj_book_tokenize(book, NULL, 0, NULL, NULL);
+ *
+ * @param book Book instance to interact with
+ * @param buf Bytes to split, does not need to be NULL terminated
+ * @param n Number of bytes in buf
+ * @param word_seps C-string of bytes that separate words, can be NULL
+ * @param group_seps C-string of bytes that separate groups, can be NULL
+ */
+void cobj_book_tokenize(cobj_book_t *book, const char *buf, size_t n, const char *word_seps, const char *group_seps);
+
 /**
  * Removes the excess of trailing allocated memory inside the book.
  *
@@ -219,7 +429,8 @@ void cobj_book_trim(cobj_book_t *book);
  * Adds a new word to the book and increments the book word count (and possibly group count) by 1. If str is
  * NULL, this function has no effect. The book's allocated memory is automatically increased if needed to
  * accommodate the new word. If str is longer than the maximum word size set during the book's creation, it
- * will be truncated to fit it in (the NULL terminator is included in the resulting string).
+ * will be truncated to fit it in (the NULL terminator is included in the resulting string). Packed books
+ * never truncate words.
  *
  * @param book Book instance to interact with
  * @param str C-string to write into the book
@@ -229,6 +440,22 @@ void cobj_book_write_new_word(cobj_book_t *book, const char *str, cobj_book_grou
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
+/**
+ * Looks for a word with the same content as a given C-string inside a group. If the group contains it several
+ * times, the position of the first occurrence is given. Without an index, see cobj_book_set_indexing(), every
+ * word of the group is compared in order.
+ * If str is NULL, the group index is out of bounds, or the given book is in an error state, false will be
+ * returned.
+ *
+ * @param book Book instance to interact with
+ * @param str C-string to look for
+ * @param group_index Group position within the book
+ * @param word_index Pointer to store the word position within the group in if found, can be NULL
+ *
+ * @return True if the word was found, false otherwise
+ */
+bool cobj_book_find_word(const cobj_book_t *book, const char *str, size_t group_index, size_t *word_index);
+
 /**
  * Gets the number of allocated word slots across all groups within the book.
  * If the given book is in an error state, 0 will be returned.
@@ -239,6 +466,27 @@ void cobj_book_write_new_word(cobj_book_t *book, const char *str, cobj_book_grou
  */
 size_t cobj_book_get_alloc_words(const cobj_book_t *book);
 
+/**
+ * Accesses the word pointed to by a cursor after it has been reset and then incremented at least once. This
+ * function never returns NULL. Instead, in case of failure, an empty string consisting of a single '\0'
+ * character is returned instead.
+ *
+ * Usage example :
+ *
+ *	cobj_book_cursor_t cursor;
+ *	cobj_book_reset_cursor(book, &cursor, group_index);
+ *	while (cobj_book_increment_cursor(book, &cursor))
+ *	{
+ *		printf("%s\n", cobj_book_get_cursor_word(book, cursor));
+ *	}
+ *
+ * @param book Book instance to interact with
+ * @param cursor Cursor to read
+ *
+ * @return C-string pointed by the cursor
+ */
+const char *cobj_book_get_cursor_word(const cobj_book_t *book, cobj_book_cursor_t cursor);
+
 /**
  * Gets the number of words a given group has.
  * If the given book is in an error state, 0 will be returned.
@@ -328,7 +576,8 @@ const char *cobj_book_get_word(const cobj_book_t *book, size_t group_index, size
 
 /**
  * Gets the maximum length of a word slot in the given book. This value is set during the book's creation by 
- * the word_n parameter in cobj_book_create().
+ * the word_n parameter in cobj_book_create(). For packed books, it is only the size of the buffers returned
+ * by cobj_book_prepare_new_word().
  * If the given book is in an error state, 0 will be returned.
  *
  * @param book Book instance to interact with
@@ -346,6 +595,41 @@ size_t cobj_book_get_word_max_size(const cobj_book_t *book);
  */
 bool cobj_book_has_failed(const cobj_book_t *book);
 
+/**
+ * Moves a cursor forward to the next word of its group, like cobj_book_increment_iterator() does with the
+ * book's internal iterator. The book is only read, the cursor being the only modified object.
+ *
+ * @param book Book instance to interact with
+ * @param cursor Cursor to move
+ *
+ * @return True if the cursor could be incremented and the next word accessed, false otherwise
+ */
+bool cobj_book_increment_cursor(const cobj_book_t *book, cobj_book_cursor_t *cursor);
+
+/**
+ * Sets a cursor to the beginning of a given group. Before accessing a word, cobj_book_increment_cursor()
+ * should be called at least once. Cursors don't need any other initialization. If the book is in a failed
+ * state or the group index is out of bounds, the cursor gets locked and any increment will fail.
+ *
+ * @param book Book instance to interact with
+ * @param cursor Cursor to set
+ * @param group_index Group to position the cursor at
+ */
+void cobj_book_reset_cursor(const cobj_book_t *book, cobj_book_cursor_t *cursor, size_t group_index);
+
+/**
+ * Writes a binary snapshot of the book to a file, to be restored later with cobj_book_load(). Groups, word
+ * offsets and word storage are each written in one block, alongside a versioned header that records the
+ * book's word size, storage mode and byte order. Mapped books are saved as regular packed books.
+ * If the given book is in an error state, nothing is written and false will be returned.
+ *
+ * @param book Book instance to interact with
+ * @param path Path of the file to write, any existing file is replaced
+ *
+ * @return True if the whole snapshot could be written, false otherwise
+ */
+bool cobj_book_save(const cobj_book_t *book, const char *path);
+
 /************************************************************************************************************/
 /************************************************************************************************************/
 /************************************************************************************************************/
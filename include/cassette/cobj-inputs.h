@@ -0,0 +1,87 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "cobj-rect.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/* fixed capacity set of inputs keyed by id, pushes of new ids are ignored while it is full */
+
+typedef struct _inputs_t cobj_inputs_t;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cobj_inputs_t *cobj_inputs_create(size_t n_alloc);
+
+cobj_inputs_t *cobj_inputs_get_placeholder(void);
+
+void cobj_inputs_destroy(cobj_inputs_t **inputs);
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void cobj_inputs_clear(cobj_inputs_t *inputs);
+
+void cobj_inputs_pull_id(cobj_inputs_t *inputs, uint32_t id);
+
+void cobj_inputs_pull_index(cobj_inputs_t *inputs, size_t index);
+
+void cobj_inputs_push(cobj_inputs_t *inputs, uint32_t id, void *ref, int x, int y);
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t cobj_inputs_count_in_bounds(const cobj_inputs_t *inputs, cobj_rect_t rect);
+
+bool cobj_inputs_find(const cobj_inputs_t *inputs, uint32_t id, size_t *index);
+
+bool cobj_inputs_find_in_bounds(const cobj_inputs_t *inputs, cobj_rect_t rect, size_t *index);
+
+size_t cobj_inputs_get_alloc_size(const cobj_inputs_t *inputs);
+
+uint32_t cobj_inputs_get_index_id(const cobj_inputs_t *inputs, size_t index);
+
+void *cobj_inputs_get_index_ref(const cobj_inputs_t *inputs, size_t index);
+
+int cobj_inputs_get_index_x(const cobj_inputs_t *inputs, size_t index);
+
+int cobj_inputs_get_index_y(const cobj_inputs_t *inputs, size_t index);
+
+size_t cobj_inputs_get_size(const cobj_inputs_t *inputs);
+
+bool cobj_inputs_has_failed(const cobj_inputs_t *inputs);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
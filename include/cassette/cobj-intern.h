@@ -0,0 +1,70 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/* string pool giving each distinct string an id in insertion order, ids stay valid until the pool is */
+/* cleared and returned strings until the next add */
+
+typedef struct _intern_t cobj_intern_t;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cobj_intern_t *cobj_intern_create(size_t n_alloc);
+
+cobj_intern_t *cobj_intern_get_placeholder(void);
+
+void cobj_intern_destroy(cobj_intern_t **intern);
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t cobj_intern_add(cobj_intern_t *intern, const char *str);
+
+void cobj_intern_clear(cobj_intern_t *intern);
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool cobj_intern_find(const cobj_intern_t *intern, const char *str, size_t *id);
+
+size_t cobj_intern_get_size(const cobj_intern_t *intern);
+
+const char *cobj_intern_get_string(const cobj_intern_t *intern, size_t id);
+
+bool cobj_intern_has_failed(const cobj_intern_t *intern);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
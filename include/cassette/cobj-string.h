@@ -21,6 +21,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #ifdef __cplusplus
@@ -31,14 +32,55 @@ extern "C" {
 /************************************************************************************************************/
 /************************************************************************************************************/
 
+/* getters taking a const string are only logically const, they fill lazily built row and codepoint lookup */
+/* tables, flatten rope content and close the gap of gap buffers, so a string must never be used by several */
+/* threads at once, not even through const getters alone, each thread should instead read its own copy made */
+/* with cobj_string_clone() or cobj_string_set() by the thread that owns the source, copies share the */
+/* source's buffer without copying it until one of them gets modified */
+
 typedef struct _string_t cobj_string_t;
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
+/* contiguous strings are a single null-terminated buffer, rope strings are a balanced tree of chunks with */
+/* O(log n) edits and lookups, their content only gets flattened into a buffer when it is read as a whole, */
+/* gap buffers keep free space at the last edit point so that consecutive edits around it are O(1), the */
+/* gap is only closed when the content is read as a whole */
+
+enum cobj_string_backend_t
+{
+	COBJ_STRING_CONTIGUOUS = 0,
+	COBJ_STRING_ROPE       = 1,
+	COBJ_STRING_GAP        = 2,
+};
+
+typedef enum cobj_string_backend_t cobj_string_backend_t;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+/* read-only range of a string's content, it is not null-terminated and gets invalidated by any */
+/* modification of the string it was taken from, views of rope strings that fit within a single chunk point */
+/* into it directly while wider ones copy only their own range, unless they cover most of the content, in */
+/* which case the rope is flattened once, views of gap buffers move the gap out of their range, so they are */
+/* only valid until the next call made on the same string */
+
+struct cobj_string_view_t
+{
+	const char *chars;
+	size_t n_bytes;
+	size_t n_codepoints;
+};
+
+typedef struct cobj_string_view_t cobj_string_view_t;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
 cobj_string_t *cobj_string_clone(const cobj_string_t *str);
 
 cobj_string_t *cobj_string_create(void);
 
+cobj_string_t *cobj_string_create_backend(cobj_string_backend_t backend);
+
 cobj_string_t *cobj_string_create_double(double d, int precision);
 
 cobj_string_t *cobj_string_get_placeholder(void);
@@ -57,6 +99,8 @@ void cobj_string_wrap(cobj_string_t *str, size_t max_cols);
 
 void cobj_string_realloc(cobj_string_t *str);
 
+void cobj_string_reserve(cobj_string_t *str, size_t n_bytes);
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
 void cobj_string_append(cobj_string_t *str, const cobj_string_t *str_src);
@@ -87,6 +131,8 @@ size_t cobj_string_convert_wrapped_offset(const cobj_string_t *str, const cobj_s
 
 size_t cobj_string_get_alloc_size(const cobj_string_t *str);
 
+cobj_string_backend_t cobj_string_get_backend(const cobj_string_t *str);
+
 const char *cobj_string_get_chars(const cobj_string_t *str);
 
 const char *cobj_string_get_chars_at_coords(const cobj_string_t *str, size_t row, size_t col);
@@ -97,6 +143,8 @@ size_t cobj_string_get_height(const cobj_string_t *str);
 
 size_t cobj_string_get_length(const cobj_string_t *str);
 
+cobj_string_view_t cobj_string_get_view(const cobj_string_t *str, size_t offset, size_t n_codepoints);
+
 size_t cobj_string_get_width(const cobj_string_t *str);
 
 bool cobj_string_has_failed(const cobj_string_t *str);
@@ -105,6 +153,18 @@ const char *cobj_string_seek_next_codepoint(const char *codepoint);
 
 size_t cobj_string_test_wrap(const cobj_string_t *str, size_t max_cols);
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+int cobj_string_view_compare(cobj_string_view_t view_1, cobj_string_view_t view_2);
+
+bool cobj_string_view_find(cobj_string_view_t view, cobj_string_view_t pattern, size_t *offset);
+
+uint64_t cobj_string_view_hash(cobj_string_view_t view);
+
+cobj_string_view_t cobj_string_view_raw(const char *c_str);
+
+size_t cobj_string_view_test_wrap(cobj_string_view_t view, size_t max_cols);
+
 /************************************************************************************************************/
 /************************************************************************************************************/
 /************************************************************************************************************/
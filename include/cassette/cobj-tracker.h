@@ -33,6 +33,18 @@ extern "C" {
 
 typedef struct _tracker_t cobj_tracker_t;
 
+typedef struct _tracker_cursor_t cobj_tracker_cursor_t;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+enum cobj_tracker_pull_mode_t
+{
+	COBJ_TRACKER_PULL_IMMEDIATE = false,
+	COBJ_TRACKER_PULL_DEFERRED  = true,
+};
+
+typedef enum cobj_tracker_pull_mode_t cobj_tracker_pull_mode_t;
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
 cobj_tracker_t *cobj_tracker_create(size_t n_alloc);
@@ -45,20 +57,34 @@ void cobj_tracker_destroy(cobj_tracker_t **tracker);
 
 void cobj_tracker_clear(cobj_tracker_t *tracker);
 
+void cobj_tracker_compact(cobj_tracker_t *tracker);
+
 bool cobj_tracker_increment_iterator(cobj_tracker_t *tracker);
 
+void cobj_tracker_intersect(cobj_tracker_t *tracker, const cobj_tracker_t *tracker_src);
+
 void cobj_tracker_lock_iterator(cobj_tracker_t *tracker);
 
 void cobj_tracker_pull_index(cobj_tracker_t *tracker, size_t index);
 
+void cobj_tracker_pull_many(cobj_tracker_t *tracker, const void *const *ptrs, size_t n);
+
 void cobj_tracker_pull_pointer(cobj_tracker_t *tracker, const void *ptr, size_t index);
 
 void cobj_tracker_push(cobj_tracker_t *tracker, const void *ptr, size_t *index);
 
+void cobj_tracker_push_many(cobj_tracker_t *tracker, const void *const *ptrs, size_t n);
+
 void cobj_tracker_reset_iterator(cobj_tracker_t *tracker);
 
+void cobj_tracker_set_pull_mode(cobj_tracker_t *tracker, cobj_tracker_pull_mode_t pull_mode);
+
+void cobj_tracker_subtract(cobj_tracker_t *tracker, const cobj_tracker_t *tracker_src);
+
 void cobj_tracker_trim(cobj_tracker_t *tracker);
 
+void cobj_tracker_unite(cobj_tracker_t *tracker, const cobj_tracker_t *tracker_src);
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
 unsigned long cobj_tracker_find(const cobj_tracker_t *tracker, const void *ptr, size_t *index);
@@ -75,6 +101,10 @@ size_t cobj_tracker_get_iterator_offset(const cobj_tracker_t *tracker);
 
 unsigned long cobj_tracker_get_iteration_n_ref(const cobj_tracker_t *tracker);
 
+const unsigned long *cobj_tracker_get_n_refs(const cobj_tracker_t *tracker, size_t index, size_t *n);
+
+const void *const *cobj_tracker_get_pointers(const cobj_tracker_t *tracker, size_t index, size_t *n);
+
 size_t cobj_tracker_get_size(const cobj_tracker_t *tracker);
 
 bool cobj_tracker_has_failed(const cobj_tracker_t *tracker);
@@ -83,6 +113,34 @@ bool cobj_tracker_has_failed(const cobj_tracker_t *tracker);
 /************************************************************************************************************/
 /************************************************************************************************************/
 
+cobj_tracker_cursor_t *cobj_tracker_cursor_create(cobj_tracker_t *tracker);
+
+cobj_tracker_cursor_t *cobj_tracker_cursor_get_placeholder(void);
+
+void cobj_tracker_cursor_destroy(cobj_tracker_cursor_t **cursor);
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool cobj_tracker_cursor_increment(cobj_tracker_cursor_t *cursor);
+
+void cobj_tracker_cursor_lock(cobj_tracker_cursor_t *cursor);
+
+void cobj_tracker_cursor_reset(cobj_tracker_cursor_t *cursor);
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+const void *cobj_tracker_cursor_get_iteration(const cobj_tracker_cursor_t *cursor);
+
+unsigned long cobj_tracker_cursor_get_iteration_n_ref(const cobj_tracker_cursor_t *cursor);
+
+size_t cobj_tracker_cursor_get_offset(const cobj_tracker_cursor_t *cursor);
+
+bool cobj_tracker_cursor_has_failed(const cobj_tracker_cursor_t *cursor);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
 #ifdef __cplusplus
 }
 #endif
@@ -23,6 +23,8 @@
 #include "cobj-book.h"
 #include "cobj-color.h"
 #include "cobj-dictionary.h"
+#include "cobj-inputs.h"
+#include "cobj-intern.h"
 #include "cobj-rand.h"
 #include "cobj-rect.h"
 #include "cobj-string.h"
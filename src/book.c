@@ -18,38 +18,186 @@
 /************************************************************************************************************/
 /************************************************************************************************************/
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <assert.h>
 #include <cassette/cobj.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "safe.h"
+#include "scan.h"
 
 /************************************************************************************************************/
 /************************************************************************************************************/
 /************************************************************************************************************/
 
+#define _MAGIC   "COBJBOOK"
+#define _VERSION 1
+#define _ENDIAN  0x01020304
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+/* index entries are keyed by content only, their group follows from their word position, so that moving */
+/* words across groups never needs a rehash */
+
+struct _entry_t
+{
+	uint64_t hash;
+	size_t word;
+};
+
+typedef struct _entry_t _entry_t;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct _key_t
+{
+	const char *str;
+	size_t index;
+	size_t n;
+};
+
+typedef struct _key_t _key_t;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct _snapshot_t
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t endian;
+	uint32_t width;
+	uint32_t packed;
+	uint64_t word_n;
+	uint64_t n_words;
+	uint64_t n_groups;
+	uint64_t n_chars;
+};
+
+typedef struct _snapshot_t _snapshot_t;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct _job_t
+{
+	const cobj_book_t *book;
+	_key_t *keys;
+	pthread_mutex_t *mutex;
+	size_t next;
+};
+
+typedef struct _job_t _job_t;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+/* sort threads are started once and kept with the book, each sort wakes the number it needs for a round */
+
+struct _pool_t
+{
+	pthread_t *threads;
+	pthread_mutex_t mutex;
+	pthread_cond_t wake;
+	pthread_cond_t done;
+	_job_t *job;
+	size_t n_threads;
+	size_t n_wanted;
+	size_t n_joined;
+	size_t n_running;
+	size_t round;
+	bool quit;
+};
+
+typedef struct _pool_t _pool_t;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
 struct _book_t
 {
 	char *words;
+	size_t *offsets;
 	size_t *groups;
+	_entry_t *entries;
+	size_t *slots;
+	_pool_t *pool;
+	size_t entries_mask;
+	size_t n_entries;
+	size_t n_alloc_slots;
+	size_t n_indexed;
 	size_t word_n;
+	size_t n_chars;
+	size_t n_alloc_chars;
+	size_t n_map;
 	size_t n_groups;
+	size_t n_alloc_groups;
 	size_t n_words;
 	size_t n_alloc;
-	size_t iterator_word;
-	size_t iterator_group;
+	cobj_book_cursor_t iterator;
+	bool packed;
+	bool pending;
+	bool streaming;
+	bool stream_word;
+	bool stream_group;
+	bool frozen;
+	bool indexing;
 	bool failed;
 };
 
+
 /************************************************************************************************************/
 /************************************************************************************************************/
 /************************************************************************************************************/
 
-static size_t _get_group_size (const cobj_book_t *book, size_t index);
-static bool   _resize         (cobj_book_t *book, size_t n, size_t a, size_t b);
+static char     *_append          (cobj_book_t *book, size_t n, cobj_book_group_mode_t group_mode);
+static bool      _check           (cobj_book_t *book);
+static int       _compare_indexes (const void *key_1, const void *key_2);
+static int       _compare_words   (const void *key_1, const void *key_2);
+static _key_t   *_create_keys     (cobj_book_t *book, size_t first, size_t n);
+static void      _erase           (cobj_book_t *book, size_t first, size_t n);
+static void      _gather          (cobj_book_t *book, size_t first, size_t n, const _key_t *keys, size_t n_keys);
+static size_t    _get_group_size  (const cobj_book_t *book, size_t index);
+static char     *_get_word        (const cobj_book_t *book, size_t index);
+static size_t    _get_word_length (const char *word, size_t word_n);
+static uint64_t  _hash            (const char *str);
+static void      _index_add       (cobj_book_t *book, size_t word);
+static void      _index_lines     (cobj_book_t *book);
+static void      _index_rebuild   (cobj_book_t *book);
+static void      _index_remove    (cobj_book_t *book, size_t word);
+static bool      _index_reserve   (cobj_book_t *book, size_t n);
+static bool      _index_resize    (cobj_book_t *book, size_t n);
+static void      _index_shift     (cobj_book_t *book, size_t first, size_t n_removed, size_t n_inserted);
+static void      _index_sync      (cobj_book_t *book);
+static char     *_insert          (cobj_book_t *book, size_t index, size_t n);
+static bool      _is_aliased      (const cobj_book_t *book, const char *str);
+static bool      _load            (cobj_book_t *book, int fd);
+static void      _pool_destroy    (_pool_t *pool);
+static bool      _pool_grow       (cobj_book_t *book, size_t n);
+static void     *_pool_run        (void *pool);
+static bool      _read            (FILE *file, void *ptr, size_t size, size_t n, bool swap);
+static bool      _reserve_chars   (cobj_book_t *book, size_t n);
+static bool      _reserve_groups  (cobj_book_t *book, size_t n);
+static bool      _reserve_words   (cobj_book_t *book, size_t n);
+static bool      _resize          (cobj_book_t *book, size_t n, size_t a, size_t b);
+static bool      _resize_chars    (cobj_book_t *book, size_t n);
+static bool      _resize_groups   (cobj_book_t *book, size_t n, size_t a, size_t b);
+static void      _settle          (cobj_book_t *book);
+static void      _sort_range      (cobj_book_t *book, size_t group_index, bool dedupe);
+static void     *_sort_worker     (void *job);
+static char     *_splice          (cobj_book_t *book, size_t index, size_t n);
+static void      _swap            (void *ptr, size_t size, size_t n);
+static void      _tokenize        (cobj_book_t *book, const char *buf, size_t n, const scan_set_t *set, bool emit,
+                                   size_t *n_words, size_t *n_groups, size_t *n_chars);
+static void      _tokenize_piece  (cobj_book_t *book, const char *str, size_t n);
+static bool      _unalias         (cobj_book_t *book, const char **str, size_t n, char **tmp);
+static bool      _write           (FILE *file, const void *ptr, size_t size, size_t n);
 
 /************************************************************************************************************/
 /************************************************************************************************************/
@@ -58,13 +206,31 @@ static bool   _resize         (cobj_book_t *book, size_t n, size_t a, size_t b);
 static cobj_book_t _err_book =
 {
 	.words          = NULL,
+	.offsets        = NULL,
 	.groups         = NULL,
+	.entries        = NULL,
+	.slots          = NULL,
+	.pool           = NULL,
+	.entries_mask   = 0,
+	.n_entries      = 0,
+	.n_alloc_slots  = 0,
+	.n_indexed      = 0,
 	.word_n         = 0,
+	.n_chars        = 0,
+	.n_alloc_chars  = 0,
+	.n_map          = 0,
 	.n_groups       = 0,
+	.n_alloc_groups = 0,
 	.n_words        = 0,
 	.n_alloc        = 0,
-	.iterator_word  = SIZE_MAX,
-	.iterator_group = SIZE_MAX,
+	.iterator       = {.group = SIZE_MAX, .word = SIZE_MAX},
+	.packed         = false,
+	.pending        = false,
+	.streaming      = false,
+	.stream_word    = false,
+	.stream_group   = false,
+	.frozen         = false,
+	.indexing       = false,
 	.failed         = true,
 };
 
@@ -77,13 +243,24 @@ cobj_book_clear(cobj_book_t *book)
 {
 	assert(book);
 
-	if (book->failed)
+	if (book->failed || book->frozen)
 	{
 		return;
 	}
 
-	book->n_words  = 0;
-	book->n_groups = 0;
+	book->n_words   = 0;
+	book->n_groups  = 0;
+	book->n_chars   = 0;
+	book->pending   = false;
+	book->streaming = false;
+
+	if (book->entries)
+	{
+		memset(book->entries, 0, (book->entries_mask + 1) * sizeof(_entry_t));
+	}
+
+	book->n_entries = 0;
+	book->n_indexed = 0;
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -101,13 +278,31 @@ cobj_book_create(size_t n_alloc, size_t word_n)
 	}
 
 	book->words          = NULL;
+	book->offsets        = NULL;
 	book->groups         = NULL;
+	book->entries        = NULL;
+	book->slots          = NULL;
+	book->pool           = NULL;
+	book->entries_mask   = 0;
+	book->n_entries      = 0;
+	book->n_alloc_slots  = 0;
+	book->n_indexed      = 0;
 	book->word_n         = word_n;
+	book->n_chars        = 0;
+	book->n_alloc_chars  = 0;
+	book->n_map          = 0;
 	book->n_groups       = 0;
+	book->n_alloc_groups = 0;
 	book->n_words        = 0;
 	book->n_alloc        = 0;
-	book->iterator_word  = SIZE_MAX;
-	book->iterator_group = SIZE_MAX;
+	book->iterator       = (cobj_book_cursor_t){.group = SIZE_MAX, .word = SIZE_MAX};
+	book->packed         = false;
+	book->pending        = false;
+	book->streaming      = false;
+	book->stream_word    = false;
+	book->stream_group   = false;
+	book->frozen         = false;
+	book->indexing       = false;
 	book->failed         = false;
 
 	_resize(book, n_alloc, 1, 0);
@@ -117,6 +312,74 @@ cobj_book_create(size_t n_alloc, size_t word_n)
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
+cobj_book_t *
+cobj_book_create_mapped(const char *path)
+{
+	cobj_book_t *book;
+	int fd;
+
+	assert(path);
+
+	if ((book = cobj_book_create(0, 1)) == &_err_book)
+	{
+		return book;
+	}
+
+	book->packed = true;
+	book->frozen = true;
+
+	if ((fd = open(path, O_RDONLY)) < 0)
+	{
+		book->failed = true;
+		return book;
+	}
+
+	if (_load(book, fd))
+	{
+		_index_lines(book);
+	}
+
+	close(fd);
+
+	return book;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cobj_book_t *
+cobj_book_create_packed(size_t n_alloc, size_t word_n)
+{
+	cobj_book_t *book;
+
+	if ((book = cobj_book_create(0, word_n)) == &_err_book)
+	{
+		return book;
+	}
+
+	book->packed = true;
+
+	_resize(book, n_alloc, 1, 0);
+
+	return book;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_book_dedupe_group(cobj_book_t *book, size_t group_index)
+{
+	assert(book);
+
+	if (book->failed || book->frozen)
+	{
+		return;
+	}
+
+	_sort_range(book, group_index, true);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
 void
 cobj_book_destroy(cobj_book_t **book)
 {
@@ -127,8 +390,21 @@ cobj_book_destroy(cobj_book_t **book)
 		return;
 	}
 
-	free((*book)->words);
+	_pool_destroy((*book)->pool);
+
+	if ((*book)->n_map > 0)
+	{
+		munmap((*book)->words, (*book)->n_map);
+	}
+	else
+	{
+		free((*book)->words);
+	}
+
+	free((*book)->offsets);
 	free((*book)->groups);
+	free((*book)->entries);
+	free((*book)->slots);
 	free(*book);
 
 	*book = &_err_book;
@@ -136,22 +412,64 @@ cobj_book_destroy(cobj_book_t **book)
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
+void
+cobj_book_erase_group(cobj_book_t *book, size_t group_index)
+{
+	assert(book);
+
+	if (book->failed || book->frozen)
+	{
+		return;
+	}
+
+	if (group_index >= book->n_groups)
+	{
+		return;
+	}
+
+	book->streaming = false;
+
+	_settle(book);
+	_erase(book, book->groups[group_index], _get_group_size(book, group_index));
+
+	memmove(
+		book->groups + group_index,
+		book->groups + group_index + 1,
+		(book->n_groups - group_index - 1) * sizeof(size_t));
+
+	book->n_groups--;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
 void
 cobj_book_erase_last_group(cobj_book_t *book)
 {
 	assert(book);
 
-	if (book->failed)
+	if (book->failed || book->frozen)
 	{
 		return;
 	}
 
+	book->streaming = false;
+
 	if (book->n_groups == 0)
 	{
 		return;
 	}
 
-	book->n_words = book->groups[--book->n_groups];
+	book->n_groups--;
+
+	while (book->n_indexed > book->groups[book->n_groups])
+	{
+		book->n_indexed--;
+		_index_remove(book, book->n_indexed);
+	}
+
+	book->n_words = book->groups[book->n_groups];
+	book->n_chars = book->packed ? book->offsets[book->n_words] : 0;
+	book->pending = false;
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -161,20 +479,133 @@ cobj_book_erase_last_word(cobj_book_t *book)
 {
 	assert(book);
 
-	if (book->failed)
+	if (book->failed || book->frozen)
 	{
 		return;
 	}
 
+	book->streaming = false;
+
 	if (book->n_words == 0)
 	{
 		return;
 	}
 
+	if (book->n_indexed == book->n_words)
+	{
+		_index_remove(book, --book->n_indexed);
+	}
+
 	if (book->groups[book->n_groups - 1] == --book->n_words)
 	{
 		book->n_groups--;
 	}
+
+	book->n_chars = book->packed ? book->offsets[book->n_words] : 0;
+	book->pending = false;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_book_erase_word(cobj_book_t *book, size_t group_index, size_t word_index)
+{
+	assert(book);
+
+	if (book->failed || book->frozen)
+	{
+		return;
+	}
+
+	if (word_index >= _get_group_size(book, group_index))
+	{
+		return;
+	}
+
+	if (_get_group_size(book, group_index) == 1)
+	{
+		cobj_book_erase_group(book, group_index);
+		return;
+	}
+
+	book->streaming = false;
+
+	_settle(book);
+	_erase(book, book->groups[group_index] + word_index, 1);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+cobj_book_find_word(const cobj_book_t *book, const char *str, size_t group_index, size_t *word_index)
+{
+	const _entry_t *entry;
+	uint64_t        hash;
+	size_t          n;
+	size_t          i;
+	size_t          found = SIZE_MAX;
+
+	assert(book);
+
+	if (book->failed)
+	{
+		return false;
+	}
+
+	if (!str || (n = _get_group_size(book, group_index)) == 0)
+	{
+		return false;
+	}
+
+	/* words that are not indexed yet can only be at the end of the book */
+
+	i = book->groups[group_index];
+
+	if (book->indexing && book->n_indexed > i)
+	{
+		i = book->n_indexed;
+	}
+
+	for (; i < book->groups[group_index] + n; i++)
+	{
+		if (strcmp(_get_word(book, i), str) == 0)
+		{
+			found = i;
+			break;
+		}
+	}
+
+	/* indexed words, entries are keyed by content only, so equal words of other groups are skipped from */
+	/* their position, and an equal word can appear several times so the whole probe sequence is checked */
+
+	if (book->indexing && book->n_entries > 0)
+	{
+		hash = _hash(str);
+		for (i = hash & book->entries_mask; book->entries[i].word > 0; i = (i + 1) & book->entries_mask)
+		{
+			entry = book->entries + i;
+			if (entry->hash == hash
+			 && entry->word - 1 >= book->groups[group_index]
+			 && entry->word - 1 < book->groups[group_index] + n
+			 && entry->word - 1 < found
+			 && strcmp(_get_word(book, entry->word - 1), str) == 0)
+			{
+				found = entry->word - 1;
+			}
+		}
+	}
+
+	if (found == SIZE_MAX)
+	{
+		return false;
+	}
+
+	if (word_index)
+	{
+		*word_index = found - book->groups[group_index];
+	}
+
+	return true;
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -194,6 +625,26 @@ cobj_book_get_alloc_words(const cobj_book_t *book)
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
+const char *
+cobj_book_get_cursor_word(const cobj_book_t *book, cobj_book_cursor_t cursor)
+{
+	assert(book);
+
+	if (book->failed)
+	{
+		return "";
+	}
+
+	if (cursor.word == 0 || cursor.word > _get_group_size(book, cursor.group))
+	{
+		return "";
+	}
+
+	return _get_word(book, book->groups[cursor.group] + cursor.word - 1);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
 size_t
 cobj_book_get_group_size(const cobj_book_t *book, size_t group_index)
 {
@@ -219,12 +670,7 @@ cobj_book_get_iteration(const cobj_book_t *book)
 		return "";
 	}
 
-	if (book->iterator_word == 0 || book->iterator_word > _get_group_size(book, book->iterator_group))
-	{
-		return "";
-	}
-
-	return book->words + (book->groups[book->iterator_group] + book->iterator_word - 1) * book->word_n;
+	return cobj_book_get_cursor_word(book, book->iterator);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -239,12 +685,12 @@ cobj_book_get_iterator_group(const cobj_book_t *book)
 		return SIZE_MAX;
 	}
 
-	if (book->iterator_group >= book->n_groups)
+	if (book->iterator.group >= book->n_groups)
 	{
 		return SIZE_MAX;
 	}
 
-	return book->iterator_group;
+	return book->iterator.group;
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -259,12 +705,12 @@ cobj_book_get_iterator_offset(const cobj_book_t *book)
 		return 0;
 	}
 
-	if (book->iterator_word > _get_group_size(book, book->iterator_group))
+	if (book->iterator.word > _get_group_size(book, book->iterator.group))
 	{
 		return 0;
 	}
 
-	return book->iterator_word;
+	return book->iterator.word;
 }
 
 
@@ -323,7 +769,7 @@ cobj_book_get_word(const cobj_book_t *book, size_t group_index, size_t word_inde
 		return "";
 	}
 
-	return book->words + (book->groups[group_index] + word_index) * book->word_n;
+	return _get_word(book, book->groups[group_index] + word_index);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -354,186 +800,1869 @@ cobj_book_has_failed(const cobj_book_t *book)
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
 bool
-cobj_book_increment_iterator(cobj_book_t *book)
+cobj_book_increment_cursor(const cobj_book_t *book, cobj_book_cursor_t *cursor)
 {
 	assert(book);
+	assert(cursor);
 
 	if (book->failed)
 	{
 		return false;
 	}
 
-	if (book->iterator_word >= _get_group_size(book, book->iterator_group))
+	if (cursor->word >= _get_group_size(book, cursor->group))
 	{
 		return false;
 	}
 
-	book->iterator_word++;
-		
+	cursor->word++;
+
 	return true;
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-void
-cobj_book_lock_iterator(cobj_book_t *book)
+bool
+cobj_book_increment_iterator(cobj_book_t *book)
 {
 	assert(book);
 
 	if (book->failed)
 	{
-		return;
+		return false;
 	}
 
-	book->iterator_group = SIZE_MAX;
-	book->iterator_word  = SIZE_MAX;
+	return cobj_book_increment_cursor(book, &book->iterator);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-char *
-cobj_book_prepare_new_word(cobj_book_t *book, cobj_book_group_mode_t group_mode)
+void
+cobj_book_insert_group(cobj_book_t *book, const char *str, size_t group_index)
 {
-	assert(book);
+	char  *word;
+	char  *tmp = NULL;
+	size_t word_index;
+	size_t n;
 
-	if (book->failed)
-	{
-		return NULL;
-	}
+	assert(book);
 
-	if (book->n_words >= book->n_alloc && !_resize(book, book->n_alloc, 2, 1))
+	if (book->failed || book->frozen)
 	{
-		return NULL;
+		return;
 	}
 
-	if (book->n_words == 0 || group_mode == COBJ_BOOK_NEW_GROUP)
+	if (!str || group_index > book->n_groups)
 	{
-		book->groups[book->n_groups++] = book->n_words;
+		return;
 	}
 
-	return book->words + book->n_words++ * book->word_n;
-}
+	book->streaming = false;
 
-/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+	_settle(book);
 
-void
-cobj_book_reset_iterator(cobj_book_t *book, size_t group_index)
-{
-	assert(book);
+	n = strlen(str) + 1;
 
-	if (book->failed)
+	if (!_unalias(book, &str, n, &tmp))
 	{
 		return;
 	}
 
-	if (group_index >= book->n_groups)
+	if (book->n_groups >= book->n_alloc_groups && !_resize_groups(book, book->n_alloc_groups, 2, 1))
 	{
+		free(tmp);
 		return;
 	}
 
-	book->iterator_word  = 0;
-	book->iterator_group = group_index;
-}
+	word_index = group_index < book->n_groups ? book->groups[group_index] : book->n_words;
 
-/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+	if ((word = _insert(book, word_index, book->packed ? n : book->word_n)))
+	{
+		snprintf(word, book->packed ? n : book->word_n, "%s", str);
 
-void
-cobj_book_rewrite_word(cobj_book_t *book, const char *str, size_t group_index, size_t word_index)
-{
-	char *word;
+		memmove(
+			book->groups + group_index + 1,
+			book->groups + group_index,
+			(book->n_groups - group_index) * sizeof(size_t));
 
-	assert(book);
+		book->groups[group_index] = word_index;
+		book->n_groups++;
 
-	if (book->failed)
-	{
+		for (size_t i = group_index + 1; i < book->n_groups; i++)
+		{
+			book->groups[i]++;
+		}
+
+		if (book->n_indexed > word_index)
+		{
+			_index_shift(book, word_index, 0, 1);
+			_index_add(book, word_index);
+		}
+	}
+
+	free(tmp);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_book_insert_word(cobj_book_t *book, const char *str, size_t group_index, size_t word_index)
+{
+	char  *word;
+	char  *tmp = NULL;
+	size_t n;
+
+	assert(book);
+
+	if (book->failed || book->frozen)
+	{
+		return;
+	}
+
+	if (!str || group_index >= book->n_groups || word_index > _get_group_size(book, group_index))
+	{
+		return;
+	}
+
+	book->streaming = false;
+
+	_settle(book);
+	_index_sync(book);
+
+	n = strlen(str) + 1;
+
+	if (!_unalias(book, &str, n, &tmp))
+	{
+		return;
+	}
+
+	word_index += book->groups[group_index];
+
+	if ((word = _insert(book, word_index, book->packed ? n : book->word_n)))
+	{
+		snprintf(word, book->packed ? n : book->word_n, "%s", str);
+
+		for (size_t i = group_index + 1; i < book->n_groups; i++)
+		{
+			book->groups[i]++;
+		}
+
+		if (book->n_indexed > word_index)
+		{
+			_index_shift(book, word_index, 0, 1);
+			_index_add(book, word_index);
+		}
+	}
+
+	free(tmp);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_book_lock_iterator(cobj_book_t *book)
+{
+	assert(book);
+
+	if (book->failed)
+	{
+		return;
+	}
+
+	book->iterator = (cobj_book_cursor_t){.group = SIZE_MAX, .word = SIZE_MAX};
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cobj_book_t *
+cobj_book_load(const char *path)
+{
+	cobj_book_t *book;
+	_snapshot_t  head;
+	FILE        *file;
+	bool         swap;
+	bool         safe = true;
+
+	assert(path);
+
+	if ((book = cobj_book_create(0, 1)) == &_err_book)
+	{
+		return book;
+	}
+
+	if (!(file = fopen(path, "rb")))
+	{
+		book->failed = true;
+		return book;
+	}
+
+	/* header, stored in the writer's byte order */
+
+	if (fread(&head, sizeof(head), 1, file) != 1 || memcmp(head.magic, _MAGIC, sizeof(head.magic)) != 0)
+	{
+		goto fail;
+	}
+
+	if ((swap = head.endian != _ENDIAN))
+	{
+		_swap(&head.version,  sizeof(head.version),  1);
+		_swap(&head.endian,   sizeof(head.endian),   1);
+		_swap(&head.width,    sizeof(head.width),    1);
+		_swap(&head.packed,   sizeof(head.packed),   1);
+		_swap(&head.word_n,   sizeof(head.word_n),   1);
+		_swap(&head.n_words,  sizeof(head.n_words),  1);
+		_swap(&head.n_groups, sizeof(head.n_groups), 1);
+		_swap(&head.n_chars,  sizeof(head.n_chars),  1);
+	}
+
+	safe &= head.version  == _VERSION;
+	safe &= head.endian   == _ENDIAN;
+	safe &= head.width    == sizeof(size_t);
+	safe &= head.word_n   >  0 && head.word_n   <= SIZE_MAX;
+	safe &= head.n_words  <= SIZE_MAX;
+	safe &= head.n_chars  <= SIZE_MAX;
+	safe &= head.n_groups <= head.n_words;
+	safe &= (head.n_groups == 0) == (head.n_words == 0);
+
+	if (!safe)
+	{
+		goto fail;
+	}
+
+	book->word_n = head.word_n;
+	book->packed = head.packed;
+
+	if (!book->packed)
+	{
+		head.n_chars = head.n_words * head.word_n;
+	}
+
+	/* arrays, one bulk read each */
+
+	if (!_resize(book, head.n_words, 1, 0) || !_resize_groups(book, head.n_groups, 1, 0))
+	{
+		goto fail;
+	}
+
+	if (book->packed && !_resize_chars(book, head.n_chars))
+	{
+		goto fail;
+	}
+
+	safe &= _read(file, book->groups, sizeof(size_t), head.n_groups, swap);
+	safe &= !book->packed || _read(file, book->offsets, sizeof(size_t), head.n_words, swap);
+	safe &= _read(file, book->words, 1, head.n_chars, false);
+
+	book->n_words  = head.n_words;
+	book->n_groups = head.n_groups;
+	book->n_chars  = book->packed ? head.n_chars : 0;
+
+	if (!safe || !_check(book))
+	{
+		goto fail;
+	}
+
+	fclose(file);
+
+	return book;
+
+fail:
+
+	fclose(file);
+	book->failed = true;
+
+	return book;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+char *
+cobj_book_prepare_new_word(cobj_book_t *book, cobj_book_group_mode_t group_mode)
+{
+	char *word;
+
+	assert(book);
+
+	if (book->failed || book->frozen)
+	{
+		return NULL;
+	}
+
+	book->streaming = false;
+
+	if (!(word = _append(book, book->word_n, group_mode)))
+	{
+		return NULL;
+	}
+
+	/* the buffer's content is only known, and can only be trimmed and indexed, once the next word is added */
+
+	book->pending = true;
+	word[0] = '\0';
+
+	_index_sync(book);
+
+	return word;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_book_reserve(cobj_book_t *book, size_t n_words, size_t n_groups)
+{
+	assert(book);
+
+	if (book->failed || book->frozen)
+	{
+		return;
+	}
+
+	if (n_words > book->n_alloc && !_resize(book, n_words, 1, 0))
+	{
+		return;
+	}
+
+	if (n_groups > book->n_alloc_groups)
+	{
+		_resize_groups(book, n_groups, 1, 0);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_book_reset_cursor(const cobj_book_t *book, cobj_book_cursor_t *cursor, size_t group_index)
+{
+	assert(book);
+	assert(cursor);
+
+	/* unlike the internal iterator, a cursor may be uninitialized, so it is always left in a defined state */
+
+	if (book->failed || group_index >= book->n_groups)
+	{
+		*cursor = (cobj_book_cursor_t){.group = SIZE_MAX, .word = SIZE_MAX};
+		return;
+	}
+
+	*cursor = (cobj_book_cursor_t){.group = group_index, .word = 0};
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_book_reset_iterator(cobj_book_t *book, size_t group_index)
+{
+	assert(book);
+
+	if (book->failed)
+	{
+		return;
+	}
+
+	if (group_index >= book->n_groups)
+	{
+		return;
+	}
+
+	book->iterator = (cobj_book_cursor_t){.group = group_index, .word = 0};
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_book_rewrite_word(cobj_book_t *book, const char *str, size_t group_index, size_t word_index)
+{
+	char  *word;
+	char  *tmp = NULL;
+	size_t n;
+
+	assert(book);
+
+	if (book->failed || book->frozen)
+	{
+		return;
+	}
+
+	if (!str)
+	{
+		return;
+	}
+
+	if (word_index >= _get_group_size(book, group_index))
+	{
+		return;
+	}
+
+	_settle(book);
+	_index_sync(book);
+
+	n = strlen(str) + 1;
+
+	if (!_unalias(book, &str, n, &tmp))
+	{
+		return;
+	}
+
+	/* packed words get resized to fit the new value instead of being truncated */
+
+	word_index += book->groups[group_index];
+
+	if (word_index < book->n_indexed)
+	{
+		_index_remove(book, word_index);
+	}
+
+	if (book->packed)
+	{
+		word = _splice(book, word_index, n);
+	}
+	else
+	{
+		word = _get_word(book, word_index);
+		memset(word, 0, book->word_n);
+	}
+
+	if (word)
+	{
+		snprintf(word, book->packed ? n : book->word_n, "%s", str);
+	}
+
+	if (word_index < book->n_indexed)
+	{
+		_index_add(book, word_index);
+	}
+
+	free(tmp);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+cobj_book_save(const cobj_book_t *book, const char *path)
+{
+	_snapshot_t head;
+	FILE       *file;
+	size_t      n_body;
+	bool        terminate;
+	bool        safe = true;
+
+	assert(book && path);
+
+	if (book->failed)
+	{
+		return false;
+	}
+
+	/* a buffer still open from cobj_book_prepare_new_word() is saved the way _settle() would trim it, and */
+	/* the last line of a mapped file without a final newline is terminated past n_chars */
+
+	n_body = book->packed ? book->n_chars : book->n_words * book->word_n;
+	terminate  = false;
+
+	if (book->packed && book->pending)
+	{
+		n_body = book->offsets[book->n_words - 1]
+		       + _get_word_length(_get_word(book, book->n_words - 1), book->word_n);
+		terminate  = true;
+	}
+	else if (book->packed && n_body > 0 && book->words[n_body - 1] != '\0')
+	{
+		terminate = true;
+	}
+
+	memcpy(head.magic, _MAGIC, sizeof(head.magic));
+
+	head.version  = _VERSION;
+	head.endian   = _ENDIAN;
+	head.width    = sizeof(size_t);
+	head.packed   = book->packed;
+	head.word_n   = book->word_n;
+	head.n_words  = book->n_words;
+	head.n_groups = book->n_groups;
+	head.n_chars  = n_body + terminate;
+
+	if (!(file = fopen(path, "wb")))
+	{
+		return false;
+	}
+
+	safe &= _write(file, &head, sizeof(head), 1);
+	safe &= _write(file, book->groups, sizeof(size_t), book->n_groups);
+	safe &= !book->packed || _write(file, book->offsets, sizeof(size_t), book->n_words);
+	safe &= _write(file, book->words, 1, n_body);
+	safe &= !terminate || _write(file, "", 1, 1);
+
+	safe &= fclose(file) == 0;
+
+	return safe;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_book_set_indexing(cobj_book_t *book, bool indexing)
+{
+	assert(book);
+
+	if (book->failed)
+	{
+		return;
+	}
+
+	if (indexing == book->indexing)
+	{
+		return;
+	}
+
+	book->indexing  = indexing;
+	book->n_entries = 0;
+	book->n_indexed = 0;
+
+	if (!indexing)
+	{
+		_index_resize(book, 0);
+		return;
+	}
+
+	_index_sync(book);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_book_sort(cobj_book_t *book, size_t n_threads)
+{
+	_job_t  job;
+	_key_t *keys;
+	size_t  n_wanted = 0;
+
+	assert(book);
+
+	if (book->failed || book->frozen)
+	{
+		return;
+	}
+
+	if (book->n_words == 0)
+	{
+		return;
+	}
+
+	book->streaming = false;
+
+	_settle(book);
+
+	if (!(keys = _create_keys(book, 0, book->n_words)))
+	{
+		return;
+	}
+
+	/* groups are sorted independently, pool threads pick them one at a time */
+
+	job.book  = book;
+	job.keys  = keys;
+	job.mutex = NULL;
+	job.next  = 0;
+
+	if (n_threads > 1 && book->n_groups > 1 && _pool_grow(book, n_threads - 1))
+	{
+		n_wanted = n_threads - 1 < book->pool->n_threads ? n_threads - 1 : book->pool->n_threads;
+		job.mutex = &book->pool->mutex;
+
+		pthread_mutex_lock(&book->pool->mutex);
+		book->pool->job       = &job;
+		book->pool->n_wanted  = n_wanted;
+		book->pool->n_joined  = 0;
+		book->pool->n_running = n_wanted;
+		book->pool->round++;
+		pthread_cond_broadcast(&book->pool->wake);
+		pthread_mutex_unlock(&book->pool->mutex);
+	}
+
+	/* the calling thread takes part in the work, so that it completes even if no thread could be started */
+
+	_sort_worker(&job);
+
+	if (n_wanted > 0)
+	{
+		pthread_mutex_lock(&book->pool->mutex);
+		while (book->pool->n_running > 0)
+		{
+			pthread_cond_wait(&book->pool->done, &book->pool->mutex);
+		}
+		book->pool->job = NULL;
+		pthread_mutex_unlock(&book->pool->mutex);
+	}
+
+	/* words are only moved once, in their final order */
+
+	_gather(book, 0, book->n_words, keys, book->n_words);
+
+	if (book->indexing)
+	{
+		_index_rebuild(book);
+	}
+
+	free(keys);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_book_sort_group(cobj_book_t *book, size_t group_index)
+{
+	assert(book);
+
+	if (book->failed || book->frozen)
+	{
+		return;
+	}
+
+	_sort_range(book, group_index, false);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_book_tokenize(cobj_book_t *book, const char *buf, size_t n, const char *word_seps, const char *group_seps)
+{
+	scan_set_t set;
+	size_t     n_words  = 0;
+	size_t     n_groups = 0;
+	size_t     n_chars  = 0;
+
+	assert(book);
+
+	if (book->failed || book->frozen)
+	{
+		return;
+	}
+
+	if (!buf)
+	{
+		book->streaming = false;
+		_index_sync(book);
+		return;
+	}
+
+	if (!book->streaming)
+	{
+		book->streaming    = true;
+		book->stream_word  = false;
+		book->stream_group = true;
+	}
+
+	_settle(book);
+
+	scan_init(&set, word_seps, group_seps);
+
+	/* count first, so that memory is only reserved once */
+
+	_tokenize(book, buf, n, &set, false, &n_words, &n_groups, &n_chars);
+
+	if (!_reserve_words(book, n_words) || !_reserve_groups(book, n_groups))
+	{
+		return;
+	}
+
+	if (book->packed && !_reserve_chars(book, n_chars))
+	{
+		return;
+	}
+
+	_tokenize(book, buf, n, &set, true, NULL, NULL, NULL);
+	_index_sync(book);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_book_trim(cobj_book_t *book)
+{
+	assert(book);
+
+	if (book->failed || book->frozen)
+	{
+		return;
+	}
+
+	_settle(book);
+
+	if (!_resize(book, book->n_words, 1, 0) || !_resize_groups(book, book->n_groups, 1, 0))
+	{
+		return;
+	}
+
+	if (book->packed)
+	{
+		_resize_chars(book, book->n_chars);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_book_write_new_word(cobj_book_t *book, const char *str, cobj_book_group_mode_t group_mode)
+{
+	char  *word;
+	char  *tmp = NULL;
+	size_t n;
+
+	assert(book);
+
+	if (book->failed || book->frozen)
+	{
+		return;
+	}
+
+	if (!str)
+	{
+		return;
+	}
+
+	book->streaming = false;
+
+	n = strlen(str) + 1;
+
+	if (!_unalias(book, &str, n, &tmp))
+	{
+		return;
+	}
+
+	/* packed words are never truncated */
+
+	if ((word = _append(book, book->packed ? n : book->word_n, group_mode)))
+	{
+		snprintf(word, book->packed ? n : book->word_n, "%s", str);
+	}
+
+	_index_sync(book);
+
+	free(tmp);
+}
+
+/************************************************************************************************************/
+/* _ ********************************************************************************************************/
+/************************************************************************************************************/
+
+static char *
+_append(cobj_book_t *book, size_t n, cobj_book_group_mode_t group_mode)
+{
+	char *word;
+
+	_settle(book);
+
+	if (book->n_words >= book->n_alloc && !_resize(book, book->n_alloc, 2, 1))
+	{
+		return NULL;
+	}
+
+	if (book->packed)
+	{
+		if (!_reserve_chars(book, n))
+		{
+			return NULL;
+		}
+		book->offsets[book->n_words] = book->n_chars;
+		book->n_chars += n;
+	}
+
+	if (book->n_words == 0 || group_mode == COBJ_BOOK_NEW_GROUP)
+	{
+		if (book->n_groups >= book->n_alloc_groups && !_resize_groups(book, book->n_alloc_groups, 2, 1))
+		{
+			return NULL;
+		}
+		book->groups[book->n_groups++] = book->n_words;
+	}
+
+	word = _get_word(book, book->n_words++);
+
+	/* fixed size slots start zeroed, so that bytes past a word's terminator never hold stale data */
+
+	if (!book->packed)
+	{
+		memset(word, 0, book->word_n);
+	}
+
+	return word;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_check(cobj_book_t *book)
+{
+	size_t start;
+	size_t end;
+
+	/* groups are in increasing word order, the first one starting at the first word */
+
+	if (book->n_groups > 0 && book->groups[0] != 0)
+	{
+		return false;
+	}
+
+	for (size_t i = 1; i < book->n_groups; i++)
+	{
+		if (book->groups[i] <= book->groups[i - 1] || book->groups[i] >= book->n_words)
+		{
+			return false;
+		}
+	}
+
+	/* words must be terminated within their own storage, fixed size slots are simply capped */
+
+	if (!book->packed)
+	{
+		for (size_t i = 0; i < book->n_words; i++)
+		{
+			_get_word(book, i)[book->word_n - 1] = '\0';
+		}
+		return true;
+	}
+
+	for (size_t i = 0; i < book->n_words; i++)
+	{
+		start = book->offsets[i];
+		end   = i + 1 < book->n_words ? book->offsets[i + 1] : book->n_chars;
+		if (start >= end || end > book->n_chars || !memchr(book->words + start, '\0', end - start))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static int
+_compare_indexes(const void *key_1, const void *key_2)
+{
+	const _key_t *k_1 = key_1;
+	const _key_t *k_2 = key_2;
+
+	return (k_1->index > k_2->index) - (k_1->index < k_2->index);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static int
+_compare_words(const void *key_1, const void *key_2)
+{
+	const _key_t *k_1 = key_1;
+	const _key_t *k_2 = key_2;
+
+	int r;
+
+	/* ties are broken by position, so that sorting is stable and the first of equal words comes first */
+
+	if ((r = strcmp(k_1->str, k_2->str)) != 0)
+	{
+		return r;
+	}
+
+	return _compare_indexes(key_1, key_2);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static _key_t *
+_create_keys(cobj_book_t *book, size_t first, size_t n)
+{
+	_key_t *keys;
+
+	if (!safe_mul(NULL, n, sizeof(_key_t)) || !(keys = malloc(n * sizeof(_key_t))))
+	{
+		book->failed = true;
+		return NULL;
+	}
+
+	for (size_t i = 0; i < n; i++)
+	{
+		keys[i].str   = _get_word(book, first + i);
+		keys[i].index = first + i;
+		keys[i].n     = strlen(keys[i].str) + 1;
+	}
+
+	return keys;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_erase(cobj_book_t *book, size_t first, size_t n)
+{
+	/* entries of the erased words are dropped and those of the following words move down with them */
+
+	for (size_t i = first; i < first + n && i < book->n_indexed; i++)
+	{
+		_index_remove(book, i);
+	}
+
+	if (book->n_indexed > first + n)
+	{
+		_index_shift(book, first + n, n, 0);
+	}
+	else if (book->n_indexed > first)
+	{
+		book->n_indexed = first;
+	}
+
+	_gather(book, first, n, NULL, 0);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_gather(cobj_book_t *book, size_t first, size_t n, const _key_t *keys, size_t n_keys)
+{
+	char  *tmp = NULL;
+	size_t start;
+	size_t end;
+	size_t n_bytes = 0;
+	size_t n_removed;
+	size_t n_gap;
+
+	/* replaces the words in [first, first + n[ by the ones pointed by the keys, in the keys' order */
+
+	if (book->packed)
+	{
+		start = book->offsets[first];
+		end   = first + n < book->n_words ? book->offsets[first + n] : book->n_chars;
+	}
+	else
+	{
+		start = first * book->word_n;
+		end   = (first + n) * book->word_n;
+	}
+
+	for (size_t i = 0; i < n_keys; i++)
+	{
+		n_bytes += book->packed ? keys[i].n : book->word_n;
+	}
+
+	if (n_bytes > 0 && !(tmp = malloc(n_bytes)))
+	{
+		book->failed = true;
+		return;
+	}
+
+	/* fixed size slots are copied whole, along with their zeroed tail */
+
+	for (size_t i = 0, j = 0; i < n_keys; i++)
+	{
+		memcpy(tmp + j, keys[i].str, book->packed ? keys[i].n : book->word_n);
+		if (book->packed)
+		{
+			book->offsets[first + i] = start + j;
+		}
+		j += book->packed ? keys[i].n : book->word_n;
+	}
+
+	if (n_bytes > 0)
+	{
+		memcpy(book->words + start, tmp, n_bytes);
+		free(tmp);
+	}
+
+	/* close the gap left by removed words */
+
+	n_removed = n - n_keys;
+	n_gap     = end - start - n_bytes;
+
+	if (n_gap == 0)
+	{
+		return;
+	}
+
+	memmove(
+		book->words + start + n_bytes,
+		book->words + end,
+		(book->packed ? book->n_chars : book->n_words * book->word_n) - end);
+
+	for (size_t i = first + n; book->packed && i < book->n_words; i++)
+	{
+		book->offsets[i - n_removed] = book->offsets[i] - n_gap;
+	}
+
+	for (size_t i = 0; i < book->n_groups; i++)
+	{
+		if (book->groups[i] >= first + n)
+		{
+			book->groups[i] -= n_removed;
+		}
+	}
+
+	book->n_words -= n_removed;
+	book->n_chars -= book->packed ? n_gap : 0;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+_get_group_size(const cobj_book_t *book, size_t index)
+{
+	if (book->n_groups == 0 || index >= book->n_groups)
+	{
+		return 0;
+	}
+	else if (index == book->n_groups - 1)
+	{
+		return book->n_words - book->groups[index];
+	}
+	else
+	{
+		return book->groups[index + 1] - book->groups[index];
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static char *
+_get_word(const cobj_book_t *book, size_t index)
+{
+	if (book->packed)
+	{
+		return book->words + book->offsets[index];
+	}
+	else
+	{
+		return book->words + index * book->word_n;
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+_get_word_length(const char *word, size_t word_n)
+{
+	const char *end;
+
+	/* a word without terminator is cut to leave room for one */
+
+	return (end = memchr(word, '\0', word_n)) ? (size_t)(end - word) : word_n - 1;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static uint64_t
+_hash(const char *str)
+{
+	const uint64_t prime = 1099511628211ULL;
+
+	uint64_t h = 14695981039346656037ULL;
+
+	/* FNV-1A */
+
+	for (; *str != '\0'; str++)
+	{
+		h = (h ^ (uint8_t)*str) * prime;
+	}
+
+	return h;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_index_add(cobj_book_t *book, size_t word)
+{
+	uint64_t hash;
+	size_t   i;
+
+	if (book->n_entries >= (book->entries_mask + 1) / 2 && !_index_resize(book, (book->entries_mask + 1) * 2))
+	{
+		return;
+	}
+
+	if (!_index_reserve(book, word + 1))
+	{
+		return;
+	}
+
+	hash = _hash(_get_word(book, word));
+
+	for (i = hash & book->entries_mask; book->entries[i].word > 0; i = (i + 1) & book->entries_mask);
+
+	book->entries[i].hash = hash;
+	book->entries[i].word = word + 1;
+	book->slots[word]     = i;
+
+	book->n_entries++;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_index_lines(cobj_book_t *book)
+{
+	char  *line;
+	char  *end;
+	char  *eol;
+	size_t n = 1;
+	size_t n_max = 0;
+	bool   new_group = true;
+
+	if (book->n_chars == 0)
+	{
+		return;
+	}
+
+	end = book->words + book->n_chars;
+
+	/* every line may be a word, so offsets are allocated once, groups grow as they are found */
+
+	for (eol = book->words; (eol = memchr(eol, '\n', end - eol)); eol++)
+	{
+		n++;
+	}
+
+	if (!_resize(book, n, 1, 0))
+	{
+		return;
+	}
+
+	/* terminate lines in place, blank lines separate groups */
+
+	for (line = book->words; line < end; line = eol + 1)
+	{
+		if (!(eol = memchr(line, '\n', end - line)))
+		{
+			eol = end;
+		}
+
+		*eol = '\0';
+
+		if (eol > line && eol[-1] == '\r')
+		{
+			eol[-1] = '\0';
+			n = eol - line - 1;
+		}
+		else
+		{
+			n = eol - line;
+		}
+
+		if (n == 0)
+		{
+			new_group = true;
+			continue;
+		}
+
+		if (new_group)
+		{
+			if (book->n_groups >= book->n_alloc_groups && !_resize_groups(book, book->n_alloc_groups, 2, 1))
+			{
+				return;
+			}
+			book->groups[book->n_groups++] = book->n_words;
+			new_group = false;
+		}
+
+		book->offsets[book->n_words++] = line - book->words;
+
+		if (n >= n_max)
+		{
+			n_max = n + 1;
+		}
+	}
+
+	book->word_n = n_max > 0 ? n_max : 1;
+
+	if (_resize(book, book->n_words, 1, 0))
+	{
+		_resize_groups(book, book->n_groups, 1, 0);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_index_rebuild(cobj_book_t *book)
+{
+	if (book->entries)
+	{
+		memset(book->entries, 0, (book->entries_mask + 1) * sizeof(_entry_t));
+	}
+
+	book->n_entries = 0;
+	book->n_indexed = 0;
+
+	_index_sync(book);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_index_remove(cobj_book_t *book, size_t word)
+{
+	size_t i;
+	size_t j;
+	size_t k;
+
+	if (!book->indexing || book->n_entries == 0 || word >= book->n_alloc_slots)
+	{
+		return;
+	}
+
+	/* the entry is found from its word position, without hashing the word */
+
+	if (book->entries[i = book->slots[word]].word != word + 1)
+	{
+		return;
+	}
+
+	/* backward shift deletion, so that probe sequences never need tombstones */
+
+	for (j = (i + 1) & book->entries_mask; book->entries[j].word > 0; j = (j + 1) & book->entries_mask)
+	{
+		k = book->entries[j].hash & book->entries_mask;
+		if (((j - k) & book->entries_mask) >= ((j - i) & book->entries_mask))
+		{
+			book->entries[i] = book->entries[j];
+			book->slots[book->entries[i].word - 1] = i;
+			i = j;
+		}
+	}
+
+	book->entries[i].word = 0;
+	book->n_entries--;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_index_reserve(cobj_book_t *book, size_t n)
+{
+	size_t *tmp;
+	size_t  n_alloc;
+
+	/* slots hold the table position of each indexed word's entry, they grow geometrically like words */
+
+	if (n <= book->n_alloc_slots)
+	{
+		return true;
+	}
+
+	if (!safe_mul(&n_alloc, book->n_alloc_slots, 2) || n_alloc < n)
+	{
+		n_alloc = n;
+	}
+
+	if (!safe_mul(NULL, n_alloc, sizeof(size_t)) || !(tmp = realloc(book->slots, n_alloc * sizeof(size_t))))
+	{
+		book->failed = true;
+		return false;
+	}
+
+	book->slots         = tmp;
+	book->n_alloc_slots = n_alloc;
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_index_resize(cobj_book_t *book, size_t n)
+{
+	_entry_t *tmp;
+	_entry_t *tmp_2;
+	size_t    n_2;
+	size_t    j;
+
+	if (n == 0)
+	{
+		free(book->entries);
+		free(book->slots);
+		book->entries       = NULL;
+		book->slots         = NULL;
+		book->entries_mask  = 0;
+		book->n_alloc_slots = 0;
+		return true;
+	}
+
+	if (!safe_mul(NULL, n, sizeof(_entry_t)) || !(tmp = calloc(n, sizeof(_entry_t))))
+	{
+		book->failed = true;
+		return false;
+	}
+
+	tmp_2 = book->entries;
+	n_2   = book->entries ? book->entries_mask + 1 : 0;
+
+	book->entries      = tmp;
+	book->entries_mask = n - 1;
+
+	/* move old entries to the new table */
+
+	for (size_t i = 0; i < n_2; i++)
+	{
+		if (tmp_2[i].word > 0)
+		{
+			for (j = tmp_2[i].hash & book->entries_mask; tmp[j].word > 0; j = (j + 1) & book->entries_mask);
+			tmp[j] = tmp_2[i];
+			book->slots[tmp[j].word - 1] = j;
+		}
+	}
+
+	free(tmp_2);
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_index_shift(cobj_book_t *book, size_t first, size_t n_removed, size_t n_inserted)
+{
+	size_t n;
+	size_t to;
+
+	/* indexed words at or after the given one moved by n_inserted - n_removed positions, their entries are */
+	/* reached through their slots, so the cost only depends on the number of words that moved */
+
+	if (!book->indexing || book->n_indexed < first)
+	{
+		return;
+	}
+
+	n  = book->n_indexed - first;
+	to = first - n_removed + n_inserted;
+
+	if (!_index_reserve(book, to + n))
+	{
+		return;
+	}
+
+	memmove(book->slots + to, book->slots + first, n * sizeof(size_t));
+
+	for (size_t i = to; i < to + n; i++)
+	{
+		book->entries[book->slots[i]].word = i + 1;
+	}
+
+	book->n_indexed = to + n;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_index_sync(cobj_book_t *book)
+{
+	size_t n;
+	size_t n_table = 16;
+
+	if (!book->indexing)
+	{
+		return;
+	}
+
+	/* a word still being written, either prepared or streamed, is left out until it is complete */
+
+	n = book->n_words - (book->pending || (book->streaming && book->stream_word && book->n_words > 0));
+
+	if (book->n_indexed >= n)
+	{
+		return;
+	}
+
+	/* size the table once for all new words, with a max load of 0.5 */
+
+	while (n_table / 2 < book->n_entries + n - book->n_indexed)
+	{
+		if (!safe_mul(&n_table, n_table, 2))
+		{
+			book->failed = true;
+			return;
+		}
+	}
+
+	if (n_table > book->entries_mask + 1 || !book->entries)
+	{
+		if (!_index_resize(book, n_table))
+		{
+			return;
+		}
+	}
+
+	for (; book->n_indexed < n; book->n_indexed++)
+	{
+		_index_add(book, book->n_indexed);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static char *
+_insert(cobj_book_t *book, size_t index, size_t n)
+{
+	size_t offset;
+
+	/* opens a gap of n bytes for a new word at the given position, O(n_chars - offset) */
+
+	if (book->n_words >= book->n_alloc && !_resize(book, book->n_alloc, 2, 1))
+	{
+		return NULL;
+	}
+
+	if (book->packed)
+	{
+		if (!_reserve_chars(book, n))
+		{
+			return NULL;
+		}
+
+		offset = index < book->n_words ? book->offsets[index] : book->n_chars;
+
+		memmove(book->words + offset + n, book->words + offset, book->n_chars - offset);
+		memmove(book->offsets + index + 1, book->offsets + index, (book->n_words - index) * sizeof(size_t));
+
+		for (size_t i = index + 1; i <= book->n_words; i++)
+		{
+			book->offsets[i] += n;
+		}
+
+		book->offsets[index] = offset;
+		book->n_chars       += n;
+	}
+	else
+	{
+		memmove(
+			book->words + (index + 1) * book->word_n,
+			book->words + index * book->word_n,
+			(book->n_words - index) * book->word_n);
+
+		memset(book->words + index * book->word_n, 0, book->word_n);
+	}
+
+	book->n_words++;
+
+	return _get_word(book, index);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_is_aliased(const cobj_book_t *book, const char *str)
+{
+	size_t n;
+
+	/* pointer comparisons across objects are not defined, so compare addresses as integers instead */
+
+	n = book->packed ? book->n_alloc_chars : book->n_alloc * book->word_n;
+
+	return (uintptr_t)str >= (uintptr_t)book->words && (uintptr_t)str < (uintptr_t)book->words + n;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_load(cobj_book_t *book, int fd)
+{
+	struct stat st;
+	size_t  n;
+	size_t  n_page;
+	char   *data;
+	ssize_t r;
+
+	if (fstat(fd, &st) < 0 || st.st_size < 0 || (uintmax_t)st.st_size >= SIZE_MAX)
+	{
+		book->failed = true;
+		return false;
+	}
+
+	if ((n = st.st_size) == 0)
+	{
+		return true;
+	}
+
+	/* map privately so lines can be terminated in place, the zeroed end of the last page ends the last line */
+
+	n_page = sysconf(_SC_PAGESIZE);
+
+	if (n_page > 0 && n % n_page != 0)
+	{
+		data = mmap(NULL, n, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if (data != MAP_FAILED)
+		{
+			posix_madvise(data, n, POSIX_MADV_SEQUENTIAL);
+			book->words         = data;
+			book->n_chars       = n;
+			book->n_alloc_chars = n;
+			book->n_map         = n;
+			return true;
+		}
+	}
+
+	if (!(data = malloc(n + 1)))
+	{
+		book->failed = true;
+		return false;
+	}
+
+	book->words         = data;
+	book->n_alloc_chars = n + 1;
+
+	while (book->n_chars < n)
+	{
+		if ((r = read(fd, data + book->n_chars, n - book->n_chars)) <= 0)
+		{
+			book->failed = true;
+			return false;
+		}
+		book->n_chars += r;
+	}
+
+	data[n] = '\0';
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_pool_destroy(_pool_t *pool)
+{
+	if (!pool)
+	{
 		return;
 	}
 
-	if (!str)
+	pthread_mutex_lock(&pool->mutex);
+	pool->quit = true;
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->mutex);
+
+	for (size_t i = 0; i < pool->n_threads; i++)
+	{
+		pthread_join(pool->threads[i], NULL);
+	}
+
+	pthread_cond_destroy(&pool->done);
+	pthread_cond_destroy(&pool->wake);
+	pthread_mutex_destroy(&pool->mutex);
+
+	free(pool->threads);
+	free(pool);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_pool_grow(cobj_book_t *book, size_t n)
+{
+	pthread_t *tmp;
+	_pool_t   *pool;
+
+	/* failures are not fatal, sorting goes on with the threads already running or on the caller alone */
+
+	if (!book->pool)
+	{
+		if (!(pool = calloc(1, sizeof(_pool_t))))
+		{
+			return false;
+		}
+
+		if (pthread_mutex_init(&pool->mutex, NULL) != 0)
+		{
+			free(pool);
+			return false;
+		}
+
+		if (pthread_cond_init(&pool->wake, NULL) != 0)
+		{
+			pthread_mutex_destroy(&pool->mutex);
+			free(pool);
+			return false;
+		}
+
+		if (pthread_cond_init(&pool->done, NULL) != 0)
+		{
+			pthread_cond_destroy(&pool->wake);
+			pthread_mutex_destroy(&pool->mutex);
+			free(pool);
+			return false;
+		}
+
+		book->pool = pool;
+	}
+
+	pool = book->pool;
+
+	if (n <= pool->n_threads)
+	{
+		return true;
+	}
+
+	if (safe_mul(NULL, n, sizeof(pthread_t)) && (tmp = realloc(pool->threads, n * sizeof(pthread_t))))
+	{
+		pool->threads = tmp;
+		for (; pool->n_threads < n; pool->n_threads++)
+		{
+			if (pthread_create(pool->threads + pool->n_threads, NULL, _pool_run, pool) != 0)
+			{
+				break;
+			}
+		}
+	}
+
+	return pool->n_threads > 0;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void *
+_pool_run(void *pool)
+{
+	_pool_t *p = pool;
+	_job_t  *job;
+	size_t   round = 0;
+
+	pthread_mutex_lock(&p->mutex);
+
+	for (;;)
+	{
+		while (p->round == round && !p->quit)
+		{
+			pthread_cond_wait(&p->wake, &p->mutex);
+		}
+
+		if (p->quit)
+		{
+			pthread_mutex_unlock(&p->mutex);
+			return NULL;
+		}
+
+		round = p->round;
+
+		/* threads beyond the number wanted for this round go back to sleep */
+
+		if (p->n_joined >= p->n_wanted)
+		{
+			continue;
+		}
+
+		p->n_joined++;
+		job = p->job;
+
+		pthread_mutex_unlock(&p->mutex);
+		_sort_worker(job);
+		pthread_mutex_lock(&p->mutex);
+
+		if (--p->n_running == 0)
+		{
+			pthread_cond_signal(&p->done);
+		}
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_read(FILE *file, void *ptr, size_t size, size_t n, bool swap)
+{
+	if (n == 0)
+	{
+		return true;
+	}
+
+	if (fread(ptr, size, n, file) != n)
+	{
+		return false;
+	}
+
+	if (swap)
+	{
+		_swap(ptr, size, n);
+	}
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_reserve_chars(cobj_book_t *book, size_t n)
+{
+	size_t n_alloc;
+
+	/* grow geometrically, so that appending words stays amortized O(1) */
+
+	if (!safe_add(&n, book->n_chars, n))
+	{
+		book->failed = true;
+		return false;
+	}
+
+	if (n <= book->n_alloc_chars)
 	{
-		return;
+		return true;
 	}
 
-	if (word_index >= _get_group_size(book, group_index))
+	if (!safe_mul(&n_alloc, book->n_alloc_chars, 2))
 	{
-		return;
+		n_alloc = n;
 	}
 
-	word = book->words + (book->groups[group_index] + word_index) * book->word_n;
-
-	snprintf(word, book->word_n, "%s", str);
+	return _resize_chars(book, n_alloc > n ? n_alloc : n);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-void
-cobj_book_trim(cobj_book_t *book)
+static bool
+_reserve_groups(cobj_book_t *book, size_t n)
 {
-	assert(book);
+	size_t n_alloc;
 
-	if (book->failed)
+	/* same growth policy as _reserve_words() */
+
+	if (!safe_add(&n, book->n_groups, n))
 	{
-		return;
+		book->failed = true;
+		return false;
+	}
+
+	if (n <= book->n_alloc_groups)
+	{
+		return true;
 	}
 
-	_resize(book, book->n_words, 1, 0);
+	if (!safe_mul(&n_alloc, book->n_alloc_groups, 2))
+	{
+		n_alloc = n;
+	}
+
+	return _resize_groups(book, n_alloc > n ? n_alloc : n, 1, 0);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-void
-cobj_book_write_new_word(cobj_book_t *book, const char *str, cobj_book_group_mode_t group_mode)
+static bool
+_reserve_words(cobj_book_t *book, size_t n)
 {
-	char *word;
+	size_t n_alloc;
 
-	assert(book);
+	/* grow geometrically, so that streamed chunks do not realloc on every call */
 
-	if (!str)
+	if (!safe_add(&n, book->n_words, n))
 	{
-		return;
+		book->failed = true;
+		return false;
+	}
+
+	if (n <= book->n_alloc)
+	{
+		return true;
 	}
-	
-	if ((word = cobj_book_prepare_new_word(book, group_mode)))
+
+	if (!safe_mul(&n_alloc, book->n_alloc, 2))
 	{
-		snprintf(word, book->word_n, "%s", str);
+		n_alloc = n;
 	}
+
+	return _resize(book, n_alloc > n ? n_alloc : n, 1, 0);
 }
 
-/************************************************************************************************************/
-/* _ ********************************************************************************************************/
-/************************************************************************************************************/
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-static size_t
-_get_group_size(const cobj_book_t *book, size_t index)
+static bool
+_resize(cobj_book_t *book, size_t n, size_t a, size_t b)
 {
-	if (book->n_groups == 0 || index >= book->n_groups)
+	bool    safe = true;
+	char   *tmp_1;
+	size_t *tmp_2;
+
+	/* test for overflow */
+
+	safe &= safe_mul(&n,   n, a);
+	safe &= safe_add(&n,   n, b);
+	safe &= safe_mul(NULL, n, book->packed ? 1 : book->word_n);
+	safe &= safe_mul(NULL, n, sizeof(size_t));
+
+	if (!safe)
 	{
-		return 0;
+		book->failed = true;
+		return false;
 	}
-	else if (index == book->n_groups - 1)
+
+	/* resize arrays, packed books keep word offsets instead of fixed size slots */
+
+	if (n == 0)
 	{
-		return book->n_words - book->groups[index];
+		if (!book->packed)
+		{
+			free(book->words);
+			book->words = NULL;
+		}
+		free(book->offsets);
+		book->offsets = NULL;
 	}
 	else
 	{
-		return book->groups[index + 1] - book->groups[index];
+		if (book->packed)
+		{
+			if (!(tmp_2 = realloc(book->offsets, n * sizeof(size_t))))
+			{
+				book->failed = true;
+				return false;
+			}
+			book->offsets = tmp_2;
+		}
+		else
+		{
+			if (!(tmp_1 = realloc(book->words, n * book->word_n)))
+			{
+				book->failed = true;
+				return false;
+			}
+			book->words = tmp_1;
+		}
 	}
+
+	book->n_alloc = n;
+
+	return true;
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
 static bool
-_resize(cobj_book_t *book, size_t n, size_t a, size_t b)
+_resize_chars(cobj_book_t *book, size_t n)
+{
+	char *tmp;
+
+	if (n == 0)
+	{
+		free(book->words);
+		tmp = NULL;
+	}
+	else if (!(tmp = realloc(book->words, n)))
+	{
+		book->failed = true;
+		return false;
+	}
+
+	book->words         = tmp;
+	book->n_alloc_chars = n;
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_resize_groups(cobj_book_t *book, size_t n, size_t a, size_t b)
 {
 	bool    safe = true;
-	char   *tmp_1;
-	size_t *tmp_2;	
+	size_t *tmp;
 
-	/* test for overflow */
+	/* groups grow on their own, most books hold far fewer groups than words */
 
 	safe &= safe_mul(&n,   n, a);
 	safe &= safe_add(&n,   n, b);
-	safe &= safe_mul(NULL, n, book->word_n);
 	safe &= safe_mul(NULL, n, sizeof(size_t));
 
 	if (!safe)
@@ -542,33 +2671,342 @@ _resize(cobj_book_t *book, size_t n, size_t a, size_t b)
 		return false;
 	}
 
-	/* resize array */
-
 	if (n == 0)
 	{
-		free(book->words);
 		free(book->groups);
-		book->words  = NULL;
-		book->groups = NULL;
+		tmp = NULL;
+	}
+	else if (!(tmp = realloc(book->groups, n * sizeof(size_t))))
+	{
+		book->failed = true;
+		return false;
+	}
+
+	book->groups         = tmp;
+	book->n_alloc_groups = n;
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_settle(cobj_book_t *book)
+{
+	char  *word;
+	size_t n;
+
+	/* trim the buffer handed out by the last cobj_book_prepare_new_word() call to its content */
+
+	if (!book->pending)
+	{
+		return;
+	}
+
+	word = _get_word(book, book->n_words - 1);
+	n    = _get_word_length(word, book->word_n);
+
+	if (book->packed)
+	{
+		word[n] = '\0';
+		book->n_chars = word + n - book->words + 1;
 	}
 	else
-	{	
-		if (!(tmp_1 = realloc(book->words, n * book->word_n)))
+	{
+		memset(word + n, 0, book->word_n - n);
+	}
+
+	book->pending = false;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_sort_range(cobj_book_t *book, size_t group_index, bool dedupe)
+{
+	_key_t *keys;
+	size_t  first;
+	size_t  n;
+	size_t  n_keys;
+
+	if ((n = _get_group_size(book, group_index)) == 0)
+	{
+		return;
+	}
+
+	book->streaming = false;
+
+	_settle(book);
+	_index_sync(book);
+
+	first = book->groups[group_index];
+
+	if (!(keys = _create_keys(book, first, n)))
+	{
+		return;
+	}
+
+	qsort(keys, n, sizeof(_key_t), _compare_words);
+
+	/* keep the first occurrence of equal words, then put the survivors back in their original order */
+
+	n_keys = n;
+
+	if (dedupe)
+	{
+		n_keys = 0;
+		for (size_t i = 0; i < n; i++)
 		{
-			book->failed = true;
-			return false;
+			if (i == 0 || strcmp(keys[i].str, keys[n_keys - 1].str) != 0)
+			{
+				keys[n_keys++] = keys[i];
+			}
+		}
+		qsort(keys, n_keys, sizeof(_key_t), _compare_indexes);
+	}
+
+	for (size_t i = first; i < first + n && i < book->n_indexed; i++)
+	{
+		_index_remove(book, i);
+	}
+
+	_gather(book, first, n, keys, n_keys);
+
+	if (book->indexing)
+	{
+		if (n_keys < n)
+		{
+			_index_shift(book, first + n, n - n_keys, 0);
 		}
-		book->words = tmp_1;
-	
-		if (!(tmp_2 = realloc(book->groups, n * sizeof(size_t))))
+		for (size_t i = first; i < first + n_keys; i++)
 		{
-			book->failed = true;
-			return false;
-		}	
-		book->groups = tmp_2;
+			_index_add(book, i);
+		}
 	}
 
-	book->n_alloc = n;
+	free(keys);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void *
+_sort_worker(void *job)
+{
+	_job_t *j = job;
+	size_t  g;
+	size_t  n;
+
+	for (;;)
+	{
+		if (j->mutex)
+		{
+			pthread_mutex_lock(j->mutex);
+		}
+
+		g = j->next++;
+
+		if (j->mutex)
+		{
+			pthread_mutex_unlock(j->mutex);
+		}
+
+		if (g >= j->book->n_groups)
+		{
+			return NULL;
+		}
+
+		n = _get_group_size(j->book, g);
+		qsort(j->keys + j->book->groups[g], n, sizeof(_key_t), _compare_words);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static char *
+_splice(cobj_book_t *book, size_t index, size_t n)
+{
+	size_t offset;
+	size_t n_old;
+
+	/* resize a packed word in place by moving all following bytes, O(n_chars - offset) */
+
+	_settle(book);
+
+	offset = book->offsets[index];
+	n_old  = (index + 1 < book->n_words ? book->offsets[index + 1] : book->n_chars) - offset;
+
+	if (n > n_old && !_reserve_chars(book, n - n_old))
+	{
+		return NULL;
+	}
+
+	memmove(
+		book->words + offset + n,
+		book->words + offset + n_old,
+		book->n_chars - offset - n_old);
+
+	for (size_t i = index + 1; i < book->n_words; i++)
+	{
+		book->offsets[i] = book->offsets[i] + n - n_old;
+	}
+
+	book->n_chars = book->n_chars + n - n_old;
+
+	return book->words + offset;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_swap(void *ptr, size_t size, size_t n)
+{
+	uint8_t *bytes = ptr;
+	uint8_t  tmp;
+
+	/* reverses the byte order of n consecutive values of a given size */
+
+	for (size_t i = 0; i < n; i++, bytes += size)
+	{
+		for (size_t j = 0; j < size / 2; j++)
+		{
+			tmp                  = bytes[j];
+			bytes[j]             = bytes[size - 1 - j];
+			bytes[size - 1 - j]  = tmp;
+		}
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_tokenize(cobj_book_t *book, const char *buf, size_t n, const scan_set_t *set, bool emit,
+          size_t *n_words, size_t *n_groups, size_t *n_chars)
+{
+	uint64_t seps;
+	uint64_t groups;
+	uint64_t span;
+	char    *word;
+	size_t   n_block;
+	size_t   j;
+	size_t   k;
+	bool     open  = book->stream_word;
+	bool     group = book->stream_group;
+
+	/* walk runs of separators and word bytes, one block of byte masks at a time */
+
+	for (size_t i = 0; i < n; i += SCAN_BLOCK)
+	{
+		n_block = n - i < SCAN_BLOCK ? n - i : SCAN_BLOCK;
+
+		scan_block(set, buf + i, n_block, &seps, &groups);
+
+		if (n_block < SCAN_BLOCK)
+		{
+			seps |= UINT64_MAX << n_block;
+		}
+
+		for (j = 0; j < n_block; j = k)
+		{
+			if (seps >> j & 1)
+			{
+				k    = j + scan_ctz(~seps >> j);
+				k    = k < n_block ? k : n_block;
+				span = (k - j < 64 ? ((uint64_t)1 << (k - j)) - 1 : UINT64_MAX) << j;
+				if (groups & span)
+				{
+					group = true;
+				}
+				open = false;
+				continue;
+			}
+
+			k = j + scan_ctz(seps >> j);
+			k = k < n_block ? k : n_block;
+
+			if (emit)
+			{
+				if (!open)
+				{
+					if (!(word = _append(book, book->packed ? 1 : book->word_n, group)))
+					{
+						return;
+					}
+					word[0] = '\0';
+				}
+				_tokenize_piece(book, buf + i + j, k - j);
+			}
+			else
+			{
+				*n_words  += !open;
+				*n_groups += !open && group;
+				*n_chars  += k - j + !open;
+			}
+
+			open  = true;
+			group = false;
+		}
+	}
+
+	if (emit)
+	{
+		book->stream_word  = open;
+		book->stream_group = group;
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_tokenize_piece(cobj_book_t *book, const char *str, size_t n)
+{
+	char  *word;
+	size_t n_word;
+
+	/* extend the last word, memory has already been reserved */
+
+	if (book->packed)
+	{
+		memcpy(book->words + book->n_chars - 1, str, n);
+		book->n_chars += n;
+		book->words[book->n_chars - 1] = '\0';
+		return;
+	}
+
+	word   = _get_word(book, book->n_words - 1);
+	n_word = strlen(word);
+	n      = n < book->word_n - 1 - n_word ? n : book->word_n - 1 - n_word;
+
+	memcpy(word + n_word, str, n);
+	word[n_word + n] = '\0';
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_unalias(cobj_book_t *book, const char **str, size_t n, char **tmp)
+{
+	/* the source string may live in the book itself and get moved, in which case a copy is used instead */
+
+	if (!_is_aliased(book, *str))
+	{
+		return true;
+	}
+
+	if (!(*tmp = malloc(n)))
+	{
+		book->failed = true;
+		return false;
+	}
+
+	*str = memcpy(*tmp, *str, n);
 
 	return true;
 }
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_write(FILE *file, const void *ptr, size_t size, size_t n)
+{
+	return n == 0 || fwrite(ptr, size, n, file) == n;
+}
@@ -0,0 +1,531 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#include <assert.h>
+#include <cassette/cobj.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "safe.h"
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+struct _inputs_t
+{
+	uint32_t *ids;
+	void **refs;
+	int *xs;
+	int *ys;
+	size_t *table;
+	size_t mask;
+	size_t n;
+	size_t n_alloc;
+	bool failed;
+};
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static void    _bounds     (cobj_rect_t rect, int *x_1, int *x_2, int *y_1, int *y_2);
+static size_t  _find_slot  (const cobj_inputs_t *inputs, uint32_t id);
+static size_t  _hash       (uint32_t id);
+static void    _unlink     (cobj_inputs_t *inputs, size_t slot);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static cobj_inputs_t _err_inputs =
+{
+	.ids     = NULL,
+	.refs    = NULL,
+	.xs      = NULL,
+	.ys      = NULL,
+	.table   = NULL,
+	.mask    = 0,
+	.n       = 0,
+	.n_alloc = 0,
+	.failed  = true,
+};
+
+/************************************************************************************************************/
+/* PUBLIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+void
+cobj_inputs_clear(cobj_inputs_t *inputs)
+{
+	assert(inputs);
+
+	if (inputs->failed)
+	{
+		return;
+	}
+
+	memset(inputs->table, 0, (inputs->mask + 1) * sizeof(size_t));
+
+	inputs->n = 0;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+cobj_inputs_count_in_bounds(const cobj_inputs_t *inputs, cobj_rect_t rect)
+{
+	size_t n = 0;
+	int x_1;
+	int x_2;
+	int y_1;
+	int y_2;
+
+	assert(inputs);
+
+	if (inputs->failed)
+	{
+		return 0;
+	}
+
+	_bounds(rect, &x_1, &x_2, &y_1, &y_2);
+
+	/* branchless, so that the compiler can vectorize it */
+
+	for (size_t i = 0; i < inputs->n; i++)
+	{
+		n += (inputs->xs[i] >= x_1) & (inputs->xs[i] <= x_2) & (inputs->ys[i] >= y_1) & (inputs->ys[i] <= y_2);
+	}
+
+	return n;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cobj_inputs_t *
+cobj_inputs_create(size_t n_alloc)
+{
+	cobj_inputs_t *inputs;
+
+	size_t n_table = 1;
+	bool   safe    = true;
+
+	/* power of 2 table size with a max load of 0.5 */
+
+	while (safe && n_table / 2 < n_alloc)
+	{
+		safe &= safe_mul(&n_table, n_table, 2);
+	}
+
+	safe &= safe_mul(NULL, n_table, sizeof(size_t));
+	safe &= safe_mul(NULL, n_alloc, sizeof(void*));
+
+	if (!safe)
+	{
+		return &_err_inputs;
+	}
+
+	if (!(inputs = malloc(sizeof(cobj_inputs_t))))
+	{
+		return &_err_inputs;
+	}
+
+	inputs->ids     = malloc(n_alloc * sizeof(uint32_t));
+	inputs->refs    = malloc(n_alloc * sizeof(void*));
+	inputs->xs      = malloc(n_alloc * sizeof(int));
+	inputs->ys      = malloc(n_alloc * sizeof(int));
+	inputs->table   = calloc(n_table, sizeof(size_t));
+	inputs->mask    = n_table - 1;
+	inputs->n       = 0;
+	inputs->n_alloc = n_alloc;
+	inputs->failed  = false;
+
+	if (!inputs->table || (n_alloc > 0 && (!inputs->ids || !inputs->refs || !inputs->xs || !inputs->ys)))
+	{
+		cobj_inputs_destroy(&inputs);
+	}
+
+	return inputs;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_inputs_destroy(cobj_inputs_t **inputs)
+{
+	assert(inputs && *inputs);
+
+	if (*inputs == &_err_inputs)
+	{
+		return;
+	}
+
+	free((*inputs)->ids);
+	free((*inputs)->refs);
+	free((*inputs)->xs);
+	free((*inputs)->ys);
+	free((*inputs)->table);
+	free(*inputs);
+
+	*inputs = &_err_inputs;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+cobj_inputs_find(const cobj_inputs_t *inputs, uint32_t id, size_t *index)
+{
+	size_t slot;
+
+	assert(inputs);
+
+	if (inputs->failed)
+	{
+		return false;
+	}
+
+	if (inputs->table[slot = _find_slot(inputs, id)] == 0)
+	{
+		return false;
+	}
+
+	if (index)
+	{
+		*index = inputs->table[slot] - 1;
+	}
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+cobj_inputs_find_in_bounds(const cobj_inputs_t *inputs, cobj_rect_t rect, size_t *index)
+{
+	int x_1;
+	int x_2;
+	int y_1;
+	int y_2;
+
+	assert(inputs && index);
+
+	if (inputs->failed)
+	{
+		return false;
+	}
+
+	_bounds(rect, &x_1, &x_2, &y_1, &y_2);
+
+	for (size_t i = *index; i < inputs->n; i++)
+	{
+		if (inputs->xs[i] >= x_1 && inputs->xs[i] <= x_2 && inputs->ys[i] >= y_1 && inputs->ys[i] <= y_2)
+		{
+			*index = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+cobj_inputs_get_alloc_size(const cobj_inputs_t *inputs)
+{
+	assert(inputs);
+
+	if (inputs->failed)
+	{
+		return 0;
+	}
+
+	return inputs->n_alloc;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+uint32_t
+cobj_inputs_get_index_id(const cobj_inputs_t *inputs, size_t index)
+{
+	assert(inputs);
+
+	if (inputs->failed)
+	{
+		return 0;
+	}
+
+	if (index >= inputs->n)
+	{
+		return 0;
+	}
+
+	return inputs->ids[index];
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void *
+cobj_inputs_get_index_ref(const cobj_inputs_t *inputs, size_t index)
+{
+	assert(inputs);
+
+	if (inputs->failed)
+	{
+		return NULL;
+	}
+
+	if (index >= inputs->n)
+	{
+		return NULL;
+	}
+
+	return inputs->refs[index];
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+int
+cobj_inputs_get_index_x(const cobj_inputs_t *inputs, size_t index)
+{
+	assert(inputs);
+
+	if (inputs->failed)
+	{
+		return 0;
+	}
+
+	if (index >= inputs->n)
+	{
+		return 0;
+	}
+
+	return inputs->xs[index];
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+int
+cobj_inputs_get_index_y(const cobj_inputs_t *inputs, size_t index)
+{
+	assert(inputs);
+
+	if (inputs->failed)
+	{
+		return 0;
+	}
+
+	if (index >= inputs->n)
+	{
+		return 0;
+	}
+
+	return inputs->ys[index];
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cobj_inputs_t *
+cobj_inputs_get_placeholder(void)
+{
+	return &_err_inputs;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+cobj_inputs_get_size(const cobj_inputs_t *inputs)
+{
+	assert(inputs);
+
+	if (inputs->failed)
+	{
+		return 0;
+	}
+
+	return inputs->n;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+cobj_inputs_has_failed(const cobj_inputs_t *inputs)
+{
+	assert(inputs);
+
+	return inputs->failed;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_inputs_pull_id(cobj_inputs_t *inputs, uint32_t id)
+{
+	size_t i;
+
+	assert(inputs);
+
+	if (cobj_inputs_find(inputs, id, &i))
+	{
+		cobj_inputs_pull_index(inputs, i);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_inputs_pull_index(cobj_inputs_t *inputs, size_t index)
+{
+	assert(inputs);
+
+	if (inputs->failed)
+	{
+		return;
+	}
+
+	if (index >= inputs->n)
+	{
+		return;
+	}
+
+	_unlink(inputs, _find_slot(inputs, inputs->ids[index]));
+
+	/* shift following inputs down and update their table entries */
+
+	for (inputs->n--; index < inputs->n; index++)
+	{
+		inputs->ids[index]  = inputs->ids[index + 1];
+		inputs->refs[index] = inputs->refs[index + 1];
+		inputs->xs[index]   = inputs->xs[index + 1];
+		inputs->ys[index]   = inputs->ys[index + 1];
+		inputs->table[_find_slot(inputs, inputs->ids[index])]--;
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_inputs_push(cobj_inputs_t *inputs, uint32_t id, void *ref, int x, int y)
+{
+	size_t slot;
+	size_t i;
+
+	assert(inputs);
+
+	if (inputs->failed)
+	{
+		return;
+	}
+
+	if (inputs->table[slot = _find_slot(inputs, id)] == 0)
+	{
+		if (inputs->n >= inputs->n_alloc)
+		{
+			return;
+		}
+		inputs->ids[inputs->n] = id;
+		inputs->table[slot]    = ++inputs->n;
+	}
+
+	i = inputs->table[slot] - 1;
+
+	inputs->refs[i] = ref;
+	inputs->xs[i]   = x;
+	inputs->ys[i]   = y;
+}
+
+/************************************************************************************************************/
+/* _ ********************************************************************************************************/
+/************************************************************************************************************/
+
+static void
+_bounds(cobj_rect_t rect, int *x_1, int *x_2, int *y_1, int *y_2)
+{
+	*x_1 = rect.width  > 0 ? rect.x : rect.x + rect.width;
+	*x_2 = rect.width  > 0 ? rect.x + rect.width : rect.x;
+	*y_1 = rect.height > 0 ? rect.y : rect.y + rect.height;
+	*y_2 = rect.height > 0 ? rect.y + rect.height : rect.y;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+_find_slot(const cobj_inputs_t *inputs, uint32_t id)
+{
+	size_t slot;
+
+	/* table entries hold an input index + 1, 0 marks an empty slot */
+
+	slot = _hash(id) & inputs->mask;
+
+	while (inputs->table[slot] != 0 && inputs->ids[inputs->table[slot] - 1] != id)
+	{
+		slot = (slot + 1) & inputs->mask;
+	}
+
+	return slot;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+_hash(uint32_t id)
+{
+	id ^= id >> 16;
+	id *= 0x45D9F3BU;
+	id ^= id >> 16;
+
+	return id;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_unlink(cobj_inputs_t *inputs, size_t slot)
+{
+	size_t home;
+	size_t i = slot;
+
+	/* backward shift deletion, entries that could have used the freed slot are moved into it */
+
+	for (;;)
+	{
+		slot = (slot + 1) & inputs->mask;
+
+		if (inputs->table[slot] == 0)
+		{
+			break;
+		}
+
+		home = _hash(inputs->ids[inputs->table[slot] - 1]) & inputs->mask;
+
+		if (i <= slot ? (i < home && home <= slot) : (i < home || home <= slot))
+		{
+			continue;
+		}
+
+		inputs->table[i] = inputs->table[slot];
+		i = slot;
+	}
+
+	inputs->table[i] = 0;
+}
@@ -0,0 +1,261 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#include <assert.h>
+#include <cassette/cobj.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+struct _intern_t
+{
+	cobj_book_t *book;
+	cobj_dictionary_t *dict;
+	bool failed;
+};
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static bool _find     (const cobj_intern_t *intern, const char *str, size_t *id, unsigned int *group);
+static bool _validate (cobj_intern_t *intern);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static cobj_intern_t _err_intern =
+{
+	.book   = NULL,
+	.dict   = NULL,
+	.failed = true,
+};
+
+/************************************************************************************************************/
+/* PUBLIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+size_t
+cobj_intern_add(cobj_intern_t *intern, const char *str)
+{
+	size_t       id;
+	unsigned int group;
+
+	assert(intern);
+
+	if (intern->failed)
+	{
+		return SIZE_MAX;
+	}
+
+	if (!str)
+	{
+		return SIZE_MAX;
+	}
+
+	if (_find(intern, str, &id, &group))
+	{
+		return id;
+	}
+
+	/* all strings live in the book's first group, so that their word index is their id */
+
+	id = cobj_book_get_number_words(intern->book);
+
+	cobj_book_write_new_word(intern->book, str, COBJ_BOOK_OLD_GROUP);
+	cobj_dictionary_write(intern->dict, str, group, id);
+
+	return _validate(intern) ? id : SIZE_MAX;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_intern_clear(cobj_intern_t *intern)
+{
+	assert(intern);
+
+	if (intern->failed)
+	{
+		return;
+	}
+
+	cobj_book_clear(intern->book);
+	cobj_dictionary_clear(intern->dict);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cobj_intern_t *
+cobj_intern_create(size_t n_alloc)
+{
+	cobj_intern_t *intern;
+
+	if (!(intern = malloc(sizeof(cobj_intern_t))))
+	{
+		return &_err_intern;
+	}
+
+	intern->book   = cobj_book_create_packed(n_alloc, 1);
+	intern->dict   = cobj_dictionary_create(n_alloc, 0.5);
+	intern->failed = false;
+
+	_validate(intern);
+
+	return intern;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_intern_destroy(cobj_intern_t **intern)
+{
+	assert(intern && *intern);
+
+	if (*intern == &_err_intern)
+	{
+		return;
+	}
+
+	cobj_book_destroy(&(*intern)->book);
+	cobj_dictionary_destroy(&(*intern)->dict);
+	free(*intern);
+
+	*intern = &_err_intern;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+cobj_intern_find(const cobj_intern_t *intern, const char *str, size_t *id)
+{
+	assert(intern);
+
+	if (intern->failed)
+	{
+		return false;
+	}
+
+	if (!str)
+	{
+		return false;
+	}
+
+	return _find(intern, str, id, NULL);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cobj_intern_t *
+cobj_intern_get_placeholder(void)
+{
+	return &_err_intern;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+cobj_intern_get_size(const cobj_intern_t *intern)
+{
+	assert(intern);
+
+	if (intern->failed)
+	{
+		return 0;
+	}
+
+	return cobj_book_get_number_words(intern->book);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+const char *
+cobj_intern_get_string(const cobj_intern_t *intern, size_t id)
+{
+	assert(intern);
+
+	if (intern->failed)
+	{
+		return "";
+	}
+
+	return cobj_book_get_word(intern->book, 0, id);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+cobj_intern_has_failed(const cobj_intern_t *intern)
+{
+	assert(intern);
+
+	return intern->failed;
+}
+
+/************************************************************************************************************/
+/* _ ********************************************************************************************************/
+/************************************************************************************************************/
+
+static bool
+_find(const cobj_intern_t *intern, const char *str, size_t *id, unsigned int *group)
+{
+	size_t       i;
+	unsigned int g;
+
+	/* the dictionary only keeps hashes, colliding strings are spread over successive groups */
+
+	for (g = 0; cobj_dictionary_find(intern->dict, str, g, &i); g++)
+	{
+		if (strcmp(cobj_book_get_word(intern->book, 0, i), str) == 0)
+		{
+			if (id)
+			{
+				*id = i;
+			}
+			return true;
+		}
+	}
+
+	if (group)
+	{
+		*group = g;
+	}
+
+	return false;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_validate(cobj_intern_t *intern)
+{
+	if (cobj_book_has_failed(intern->book) || cobj_dictionary_has_failed(intern->dict))
+	{
+		intern->failed = true;
+	}
+
+	return !intern->failed;
+}
@@ -0,0 +1,83 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#include <stdlib.h>
+
+#include "refs.h"
+
+/************************************************************************************************************/
+/* PRIVATE **************************************************************************************************/
+/************************************************************************************************************/
+
+size_t
+refs_decrement(refs_t *refs)
+{
+	/* the last owner must see every write made by the others before freeing what the counter guards */
+
+#if defined(REFS_C11)
+	return atomic_fetch_sub_explicit(refs, 1, memory_order_acq_rel) - 1;
+#elif defined(__GNUC__)
+	return __atomic_sub_fetch(refs, 1, __ATOMIC_ACQ_REL);
+#else
+	return --*refs;
+#endif
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+refs_increment(refs_t *refs)
+{
+	/* a new owner can only come from an existing one, so no ordering is needed */
+
+#if defined(REFS_C11)
+	atomic_fetch_add_explicit(refs, 1, memory_order_relaxed);
+#elif defined(__GNUC__)
+	__atomic_add_fetch(refs, 1, __ATOMIC_RELAXED);
+#else
+	++*refs;
+#endif
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+refs_init(refs_t *refs, size_t n)
+{
+#if defined(REFS_C11)
+	atomic_init(refs, n);
+#else
+	*refs = n;
+#endif
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+refs_load(refs_t *refs)
+{
+#if defined(REFS_C11)
+	return atomic_load_explicit(refs, memory_order_acquire);
+#elif defined(__GNUC__)
+	return __atomic_load_n(refs, __ATOMIC_ACQUIRE);
+#else
+	return *refs;
+#endif
+}
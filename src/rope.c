@@ -0,0 +1,782 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rope.h"
+#include "utf8.h"
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/* max number of bytes held by a single node */
+
+#define _CHUNK 1024
+
+/* unused nodes kept around between operations, enough for any cut and for inserts of a few chunks */
+
+#define _SPARES 8
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/* the rope is a treap ordered by codepoint position, each node holds a chunk of text that never splits a */
+/* codepoint, along with the metadata of its chunk and of its whole subtree */
+
+struct _node_t
+{
+	struct _node_t *left;
+	struct _node_t *right;
+	rope_stats_t own;
+	rope_stats_t sum;
+	uint32_t priority;
+	size_t n;
+	char chars[_CHUNK];
+};
+
+typedef struct _node_t _node_t;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct _rope_t
+{
+	_node_t *root;
+	_node_t *spares;
+	size_t n_spares;
+	size_t n_nodes;
+	uint32_t seed;
+};
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static bool         _append         (_node_t *node, const char *chars, size_t n);
+static size_t       _chunk          (const char *chars, size_t n);
+static _node_t *    _coalesce       (rope_t *rope, _node_t *left, _node_t *right);
+static char *       _copy           (const _node_t *node, size_t byte, size_t n, char *chars);
+static char *       _flatten        (const _node_t *node, char *chars);
+static void         _free           (rope_t *rope, _node_t *node);
+static rope_stats_t _join           (rope_stats_t a, rope_stats_t b);
+static void         _measure        (_node_t *node);
+static _node_t *    _merge          (_node_t *a, _node_t *b);
+static _node_t *    _pop_leftmost   (_node_t *node, _node_t **leftmost);
+static void         _release        (rope_t *rope, size_t n);
+static bool         _reserve        (rope_t *rope, size_t n);
+static void         _split          (rope_t *rope, _node_t *node, size_t offset, _node_t **left, _node_t **right);
+static _node_t *    _take           (rope_t *rope);
+static void         _update         (_node_t *node);
+
+/************************************************************************************************************/
+/* PRIVATE **************************************************************************************************/
+/************************************************************************************************************/
+
+void
+rope_clear(rope_t *rope)
+{
+	_free(rope, rope->root);
+
+	rope->root = NULL;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+rope_copy(const rope_t *rope, size_t byte, size_t n, char *chars)
+{
+	_copy(rope->root, byte, n, chars);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+rope_t *
+rope_create(void)
+{
+	rope_t *rope;
+
+	if (!(rope = malloc(sizeof(rope_t))))
+	{
+		return NULL;
+	}
+
+	rope->root     = NULL;
+	rope->spares   = NULL;
+	rope->n_spares = 0;
+	rope->n_nodes  = 0;
+	rope->seed     = 2463534242;
+
+	return rope;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+rope_cut(rope_t *rope, size_t offset, size_t n_codepoints)
+{
+	_node_t *left;
+	_node_t *middle;
+	_node_t *right;
+
+	/* each of the 2 splits may need a new node when it falls inside a chunk */
+
+	if (!_reserve(rope, 2))
+	{
+		return false;
+	}
+
+	_split(rope, rope->root, offset,       &left,   &middle);
+	_split(rope, middle,     n_codepoints, &middle, &right);
+	_free(rope, middle);
+
+	rope->root = _coalesce(rope, left, right);
+
+	_release(rope, _SPARES);
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+rope_destroy(rope_t *rope)
+{
+	_free(rope, rope->root);
+	_release(rope, 0);
+	free(rope);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+rope_flatten(const rope_t *rope, char *chars)
+{
+	_flatten(rope->root, chars);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+rope_get_alloc_size(const rope_t *rope)
+{
+	return rope->n_nodes * sizeof(_node_t);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+rope_get_byte(const rope_t *rope, size_t offset)
+{
+	const _node_t *node = rope->root;
+	size_t         byte = 0;
+
+	while (node)
+	{
+		if (node->left && offset < node->left->sum.n_codepoints)
+		{
+			node = node->left;
+			continue;
+		}
+
+		if (node->left)
+		{
+			offset -= node->left->sum.n_codepoints;
+			byte   += node->left->sum.n_bytes;
+		}
+
+		if (offset < node->own.n_codepoints)
+		{
+			return byte + utf8_seek(node->chars, node->n, offset);
+		}
+
+		offset -= node->own.n_codepoints;
+		byte   += node->own.n_bytes;
+		node    = node->right;
+	}
+
+	return byte;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+rope_get_row(const rope_t *rope, size_t row, size_t *byte, size_t *codepoint)
+{
+	const _node_t *node = rope->root;
+	const char    *end;
+
+	*byte      = 0;
+	*codepoint = 0;
+
+	/* a row starts right after the newline that has the same rank */
+
+	while (node && row > 0)
+	{
+		if (node->left && row <= node->left->sum.n_newlines)
+		{
+			node = node->left;
+			continue;
+		}
+
+		if (node->left)
+		{
+			row        -= node->left->sum.n_newlines;
+			*byte      += node->left->sum.n_bytes;
+			*codepoint += node->left->sum.n_codepoints;
+		}
+
+		if (row <= node->own.n_newlines)
+		{
+			for (end = node->chars - 1; row > 0; row--)
+			{
+				end = memchr(end + 1, '\n', node->chars + node->n - end - 1);
+			}
+
+			*byte      += end - node->chars + 1;
+			*codepoint += utf8_count(node->chars, end - node->chars + 1, NULL);
+			return;
+		}
+
+		row        -= node->own.n_newlines;
+		*byte      += node->own.n_bytes;
+		*codepoint += node->own.n_codepoints;
+		node        = node->right;
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+const char *
+rope_get_span(const rope_t *rope, size_t offset, size_t n_codepoints, size_t *n_bytes)
+{
+	const _node_t *node = rope->root;
+	size_t         byte;
+
+	/* codepoints can only be pointed at directly when they are all stored in the same node */
+
+	while (node)
+	{
+		if (node->left && offset < node->left->sum.n_codepoints)
+		{
+			node = node->left;
+			continue;
+		}
+
+		if (node->left)
+		{
+			offset -= node->left->sum.n_codepoints;
+		}
+
+		if (offset < node->own.n_codepoints)
+		{
+			break;
+		}
+
+		offset -= node->own.n_codepoints;
+		node    = node->right;
+	}
+
+	if (!node || n_codepoints > node->own.n_codepoints - offset)
+	{
+		return NULL;
+	}
+
+	byte     = utf8_seek(node->chars, node->n, offset);
+	*n_bytes = utf8_seek(node->chars + byte, node->n - byte, n_codepoints);
+
+	return node->chars + byte;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+rope_stats_t
+rope_get_stats(const rope_t *rope)
+{
+	rope_stats_t stats = {0};
+
+	return rope->root ? rope->root->sum : stats;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+rope_insert(rope_t *rope, size_t offset, const char *chars, size_t n)
+{
+	_node_t *left;
+	_node_t *right;
+	_node_t *node;
+	size_t   m;
+
+	/* worst case, one node for the split and one per chunk of new text, a chunk being at least _CHUNK - 3 */
+	/* bytes long because it only gets shortened to not split a codepoint */
+
+	if (!_reserve(rope, 2 + n / (_CHUNK - 3)))
+	{
+		return false;
+	}
+
+	_split(rope, rope->root, offset, &left, &right);
+
+	/* new text fills up the room left in the preceding node first, so that typing doesn't create nodes */
+
+	if (!_append(left, chars, n))
+	{
+		for (size_t i = 0; i < n; i += m)
+		{
+			m    = _chunk(chars + i, n - i);
+			node = _take(rope);
+
+			memcpy(node->chars, chars + i, m);
+			node->n = m;
+			_measure(node);
+
+			left = _merge(left, node);
+		}
+	}
+
+	rope->root = _coalesce(rope, left, right);
+
+	_release(rope, _SPARES);
+
+	return true;
+}
+
+/************************************************************************************************************/
+/* _ ********************************************************************************************************/
+/************************************************************************************************************/
+
+static bool
+_append(_node_t *node, const char *chars, size_t n)
+{
+	/* appends text to the last chunk of a subtree if it fits */
+
+	if (!node)
+	{
+		return false;
+	}
+
+	if (node->right)
+	{
+		if (!_append(node->right, chars, n))
+		{
+			return false;
+		}
+	}
+	else
+	{
+		if (node->n + n > _CHUNK)
+		{
+			return false;
+		}
+		memcpy(node->chars + node->n, chars, n);
+		node->n += n;
+		_measure(node);
+	}
+
+	_update(node);
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+_chunk(const char *chars, size_t n)
+{
+	size_t m = _CHUNK;
+
+	if (n <= _CHUNK)
+	{
+		return n;
+	}
+
+	/* the next chunk must start on a lead byte, unless the text is not valid UTF-8 */
+
+	while (m > _CHUNK - 4 && ((uint8_t)chars[m] >> 6) == 0x02)
+	{
+		m--;
+	}
+
+	return ((uint8_t)chars[m] >> 6) == 0x02 ? _CHUNK : m;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static _node_t *
+_coalesce(rope_t *rope, _node_t *left, _node_t *right)
+{
+	_node_t *node;
+
+	/* merges two ropes, the chunks on each side of the junction become one if they fit in a single node, */
+	/* which keeps repeated edits at the same place from fragmenting the rope */
+
+	for (node = right; node && node->left; node = node->left);
+
+	if (node && _append(left, node->chars, node->n))
+	{
+		right = _pop_leftmost(right, &node);
+		node->left  = NULL;
+		node->right = NULL;
+		_free(rope, node);
+	}
+
+	return _merge(left, right);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static char *
+_copy(const _node_t *node, size_t byte, size_t n, char *chars)
+{
+	size_t n_left;
+	size_t m;
+
+	/* same as _flatten(), but limited to n bytes from the given byte offset, subtrees outside of that */
+	/* range are skipped */
+
+	if (!node || n == 0)
+	{
+		return chars;
+	}
+
+	n_left = node->left ? node->left->sum.n_bytes : 0;
+
+	if (byte < n_left)
+	{
+		m     = n < n_left - byte ? n : n_left - byte;
+		chars = _copy(node->left, byte, m, chars);
+		byte += m;
+		n    -= m;
+	}
+
+	if (n > 0 && byte < n_left + node->n)
+	{
+		m = n < n_left + node->n - byte ? n : n_left + node->n - byte;
+		memcpy(chars, node->chars + byte - n_left, m);
+		chars += m;
+		byte  += m;
+		n     -= m;
+	}
+
+	return _copy(node->right, byte - n_left - node->n, n, chars);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static char *
+_flatten(const _node_t *node, char *chars)
+{
+	if (!node)
+	{
+		return chars;
+	}
+
+	chars = _flatten(node->left, chars);
+	memcpy(chars, node->chars, node->n);
+	chars = _flatten(node->right, chars + node->n);
+
+	return chars;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_free(rope_t *rope, _node_t *node)
+{
+	if (!node)
+	{
+		return;
+	}
+
+	_free(rope, node->left);
+	_free(rope, node->right);
+
+	/* recycle the node for the next operations, as long as the pool is not full */
+
+	if (rope->n_spares < _SPARES)
+	{
+		node->left   = rope->spares;
+		rope->spares = node;
+		rope->n_spares++;
+	}
+	else
+	{
+		free(node);
+		rope->n_nodes--;
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static rope_stats_t
+_join(rope_stats_t a, rope_stats_t b)
+{
+	rope_stats_t stats;
+	size_t       joint;
+
+	/* the last row of a and the first row of b form a single row */
+
+	joint = a.tail + b.head;
+
+	stats.n_bytes      = a.n_bytes      + b.n_bytes;
+	stats.n_codepoints = a.n_codepoints + b.n_codepoints;
+	stats.n_newlines   = a.n_newlines   + b.n_newlines;
+	stats.head         = a.n_newlines > 0 ? a.head : joint;
+	stats.tail         = b.n_newlines > 0 ? b.tail : joint;
+	stats.widest       = a.widest > b.widest ? a.widest : b.widest;
+	stats.widest       = joint > stats.widest ? joint : stats.widest;
+
+	return stats;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_measure(_node_t *node)
+{
+	const char *row = node->chars;
+	const char *end = node->chars + node->n;
+	const char *next;
+	size_t      width;
+
+	/* metadata of the node's own chunk, one vectorized count per row */
+
+	node->own.n_bytes      = node->n;
+	node->own.n_codepoints = 0;
+	node->own.n_newlines   = 0;
+	node->own.widest       = 0;
+
+	for (;; row = next + 1)
+	{
+		next  = memchr(row, '\n', end - row);
+		width = utf8_count(row, (next ? next : end) - row, NULL);
+
+		if (row == node->chars)
+		{
+			node->own.head = width;
+		}
+
+		node->own.n_codepoints += width;
+		node->own.widest        = width > node->own.widest ? width : node->own.widest;
+
+		if (!next)
+		{
+			node->own.tail = width;
+			break;
+		}
+
+		node->own.n_codepoints++;
+		node->own.n_newlines++;
+	}
+
+	_update(node);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static _node_t *
+_merge(_node_t *a, _node_t *b)
+{
+	if (!a)
+	{
+		return b;
+	}
+
+	if (!b)
+	{
+		return a;
+	}
+
+	if (a->priority >= b->priority)
+	{
+		a->right = _merge(a->right, b);
+		_update(a);
+		return a;
+	}
+	else
+	{
+		b->left = _merge(a, b->left);
+		_update(b);
+		return b;
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static _node_t *
+_pop_leftmost(_node_t *node, _node_t **leftmost)
+{
+	if (!node->left)
+	{
+		*leftmost = node;
+		return node->right;
+	}
+
+	node->left = _pop_leftmost(node->left, leftmost);
+	_update(node);
+
+	return node;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_release(rope_t *rope, size_t n)
+{
+	_node_t *node;
+
+	/* only keep n spare nodes, big inserts may have reserved many more than they used */
+
+	while (rope->n_spares > n)
+	{
+		node = rope->spares;
+		rope->spares = node->left;
+		rope->n_spares--;
+		rope->n_nodes--;
+		free(node);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_reserve(rope_t *rope, size_t n)
+{
+	_node_t *node;
+
+	/* all the nodes an operation may need are allocated before the rope gets modified, so that a failure */
+	/* leaves it untouched */
+
+	while (rope->n_spares < n)
+	{
+		if (!(node = malloc(sizeof(_node_t))))
+		{
+			_release(rope, _SPARES);
+			return false;
+		}
+
+		node->left   = rope->spares;
+		rope->spares = node;
+		rope->n_spares++;
+		rope->n_nodes++;
+	}
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_split(rope_t *rope, _node_t *node, size_t offset, _node_t **left, _node_t **right)
+{
+	_node_t *node_2;
+	size_t   n_left;
+	size_t   byte;
+
+	if (!node)
+	{
+		*left  = NULL;
+		*right = NULL;
+		return;
+	}
+
+	n_left = node->left ? node->left->sum.n_codepoints : 0;
+
+	if (offset <= n_left)
+	{
+		_split(rope, node->left, offset, left, &node->left);
+		_update(node);
+		*right = node;
+	}
+	else if (offset >= n_left + node->own.n_codepoints)
+	{
+		_split(rope, node->right, offset - n_left - node->own.n_codepoints, &node->right, right);
+		_update(node);
+		*left = node;
+	}
+	else
+	{
+		/* the end of the chunk moves to a new node, which takes over the right subtree, and inherits the */
+		/* node's priority to keep the heap order */
+
+		byte   = utf8_seek(node->chars, node->n, offset - n_left);
+		node_2 = _take(rope);
+
+		memcpy(node_2->chars, node->chars + byte, node->n - byte);
+
+		node_2->n        = node->n - byte;
+		node_2->priority = node->priority;
+		node_2->right    = node->right;
+		node->n          = byte;
+		node->right      = NULL;
+
+		_measure(node);
+		_measure(node_2);
+
+		*left  = node;
+		*right = node_2;
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static _node_t *
+_take(rope_t *rope)
+{
+	_node_t *node = rope->spares;
+
+	rope->spares = node->left;
+	rope->n_spares--;
+
+	/* xorshift32, priorities only need to be spread out, not unpredictable */
+
+	rope->seed ^= rope->seed << 13;
+	rope->seed ^= rope->seed >> 17;
+	rope->seed ^= rope->seed << 5;
+
+	node->left     = NULL;
+	node->right    = NULL;
+	node->priority = rope->seed;
+	node->n        = 0;
+
+	return node;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_update(_node_t *node)
+{
+	node->sum = node->own;
+
+	if (node->left)
+	{
+		node->sum = _join(node->left->sum, node->sum);
+	}
+
+	if (node->right)
+	{
+		node->sum = _join(node->sum, node->right->sum);
+	}
+}
@@ -0,0 +1,75 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/* metadata of a piece of text, rows are delimited by newlines and their width is counted in codepoints */
+
+struct _rope_stats_t
+{
+	size_t n_bytes;
+	size_t n_codepoints;
+	size_t n_newlines;
+	size_t head;   /* width of the first row */
+	size_t tail;   /* width of the last row */
+	size_t widest; /* width of the widest row */
+};
+
+typedef struct _rope_stats_t rope_stats_t;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+typedef struct _rope_t rope_t;
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+void rope_clear(rope_t *rope);
+
+void rope_copy(const rope_t *rope, size_t byte, size_t n, char *chars);
+
+rope_t *rope_create(void);
+
+bool rope_cut(rope_t *rope, size_t offset, size_t n_codepoints);
+
+void rope_destroy(rope_t *rope);
+
+void rope_flatten(const rope_t *rope, char *chars);
+
+size_t rope_get_alloc_size(const rope_t *rope);
+
+size_t rope_get_byte(const rope_t *rope, size_t offset);
+
+void rope_get_row(const rope_t *rope, size_t row, size_t *byte, size_t *codepoint);
+
+const char *rope_get_span(const rope_t *rope, size_t offset, size_t n_codepoints, size_t *n_bytes);
+
+rope_stats_t rope_get_stats(const rope_t *rope);
+
+bool rope_insert(rope_t *rope, size_t offset, const char *chars, size_t n);
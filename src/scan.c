@@ -0,0 +1,214 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+#elif defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+
+#include "scan.h"
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/* past this number of separator bytes, one table lookup per byte is cheaper than one compare per separator */
+
+#define _SIMD_MAX 8
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static void _scan_scalar (const scan_set_t *set, const char *buf, size_t n, uint64_t *seps, uint64_t *groups);
+
+#if defined(__AVX2__) || defined(__SSE2__)
+static void _scan_simd   (const scan_set_t *set, const char *buf, uint64_t *seps, uint64_t *groups);
+#endif
+
+/************************************************************************************************************/
+/* PRIVATE **************************************************************************************************/
+/************************************************************************************************************/
+
+void
+scan_block(const scan_set_t *set, const char *buf, size_t n, uint64_t *seps, uint64_t *groups)
+{
+#if defined(__AVX2__) || defined(__SSE2__)
+	if (n == SCAN_BLOCK && set->n_bytes <= _SIMD_MAX)
+	{
+		_scan_simd(set, buf, seps, groups);
+		return;
+	}
+#endif
+
+	_scan_scalar(set, buf, n, seps, groups);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+scan_ctz(uint64_t mask)
+{
+	size_t n = 0;
+
+	if (mask == 0)
+	{
+		return 64;
+	}
+
+#if defined(__GNUC__)
+	n = __builtin_ctzll(mask);
+#else
+	while (!(mask & 1))
+	{
+		mask >>= 1;
+		n++;
+	}
+#endif
+
+	return n;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+scan_init(scan_set_t *set, const char *word_seps, const char *group_seps)
+{
+	memset(set->classes, 0, sizeof(set->classes));
+
+	/* NULL bytes can't be part of C-strings, so they always separate words */
+
+	set->classes[0] = SCAN_SEP;
+
+	for (; word_seps && *word_seps; word_seps++)
+	{
+		set->classes[(uint8_t)*word_seps] |= SCAN_SEP;
+	}
+
+	for (; group_seps && *group_seps; group_seps++)
+	{
+		set->classes[(uint8_t)*group_seps] |= SCAN_SEP | SCAN_GROUP;
+	}
+
+	/* distinct separator bytes, used for vector compares */
+
+	set->n_bytes = 0;
+	for (size_t i = 0; i < 256; i++)
+	{
+		if (set->classes[i])
+		{
+			set->bytes[set->n_bytes++] = i;
+		}
+	}
+}
+
+/************************************************************************************************************/
+/* _ ********************************************************************************************************/
+/************************************************************************************************************/
+
+static void
+_scan_scalar(const scan_set_t *set, const char *buf, size_t n, uint64_t *seps, uint64_t *groups)
+{
+	uint8_t c;
+
+	*seps   = 0;
+	*groups = 0;
+
+	for (size_t i = 0; i < n; i++)
+	{
+		c        = set->classes[(uint8_t)buf[i]];
+		*seps   |= (uint64_t)(c & SCAN_SEP) << i;
+		*groups |= (uint64_t)((c & SCAN_GROUP) >> 1) << i;
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+#if defined(__AVX2__)
+
+static void
+_scan_simd(const scan_set_t *set, const char *buf, uint64_t *seps, uint64_t *groups)
+{
+	__m256i  v_1;
+	__m256i  v_2;
+	__m256i  b;
+	uint64_t m;
+
+	*seps   = 0;
+	*groups = 0;
+
+	v_1 = _mm256_loadu_si256((const __m256i*)buf);
+	v_2 = _mm256_loadu_si256((const __m256i*)(buf + 32));
+
+	for (size_t i = 0; i < set->n_bytes; i++)
+	{
+		b = _mm256_set1_epi8(set->bytes[i]);
+		m = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v_1, b))
+		  | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v_2, b)) << 32;
+
+		*seps |= m;
+		if (set->classes[set->bytes[i]] & SCAN_GROUP)
+		{
+			*groups |= m;
+		}
+	}
+}
+
+#elif defined(__SSE2__)
+
+static void
+_scan_simd(const scan_set_t *set, const char *buf, uint64_t *seps, uint64_t *groups)
+{
+	__m128i  v[4];
+	__m128i  b;
+	uint64_t m;
+
+	*seps   = 0;
+	*groups = 0;
+
+	for (size_t j = 0; j < 4; j++)
+	{
+		v[j] = _mm_loadu_si128((const __m128i*)(buf + j * 16));
+	}
+
+	for (size_t i = 0; i < set->n_bytes; i++)
+	{
+		b = _mm_set1_epi8(set->bytes[i]);
+		m = 0;
+		for (size_t j = 0; j < 4; j++)
+		{
+			m |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v[j], b)) << (j * 16);
+		}
+
+		*seps |= m;
+		if (set->classes[set->bytes[i]] & SCAN_GROUP)
+		{
+			*groups |= m;
+		}
+	}
+}
+
+#endif
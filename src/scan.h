@@ -0,0 +1,56 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#define SCAN_BLOCK 64
+
+/* byte classes */
+
+#define SCAN_SEP   0x01
+#define SCAN_GROUP 0x02
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct _scan_set_t
+{
+	uint8_t classes[256];
+	uint8_t bytes[256];
+	size_t  n_bytes;
+};
+
+typedef struct _scan_set_t scan_set_t;
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+void scan_block(const scan_set_t *set, const char *buf, size_t n, uint64_t *seps, uint64_t *groups);
+
+size_t scan_ctz(uint64_t mask);
+
+void scan_init(scan_set_t *set, const char *word_seps, const char *group_seps);
@@ -21,34 +21,157 @@
 #include <assert.h>
 #include <cassette/cobj.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "refs.h"
+#include "rope.h"
 #include "safe.h"
+#include "utf8.h"
 
 /************************************************************************************************************/
 /************************************************************************************************************/
 /************************************************************************************************************/
 
+/* number of codepoints between two cached byte offsets, the most a codepoint lookup has to scan */
+
+#define _CHECKPOINT 256
+
+/* size of the buffer embedded in each string, enough for most labels to never need a heap allocation */
+
+#define _INLINE 32
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/* heap storage of contiguous strings, shared between strings by cobj_string_set() and cobj_string_clone() */
+/* until one of them modifies it */
+
+struct _buffer_t
+{
+	refs_t n_refs;
+	char chars[];
+};
+
+typedef struct _buffer_t _buffer_t;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+/* copy of a range of a rope string that spans several of its nodes, kept alive for the views pointing to */
+/* it until the next edit */
+
+struct _span_t
+{
+	struct _span_t *next;
+	char chars[];
+};
+
+typedef struct _span_t _span_t;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct _row_t
+{
+	size_t byte;
+	size_t codepoint;
+};
+
+typedef struct _row_t _row_t;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+/* lookup tables derived from the content, filled lazily, including by const getters, and truncated at the */
+/* edit point of each modification, rope strings only use the flattened copy of their content, the gap of */
+/* gap buffers lives here too so that const getters can close it */
+
+struct _cache_t
+{
+	_row_t *rows;
+	size_t n_rows;
+	size_t n_alloc_rows;
+	size_t *checkpoints;
+	size_t n_checkpoints;
+	size_t n_alloc_checkpoints;
+	char *flat;
+	size_t n_alloc_flat;
+	bool flat_valid;
+	_span_t *spans;
+	size_t n_tail;
+	size_t n_tail_codepoints;
+};
+
+typedef struct _cache_t _cache_t;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
 struct _string_t
 {
 	char *chars;
+	char chars_inline[_INLINE];
+	rope_t *rope;
+	_cache_t *cache;
 	size_t n_rows;
 	size_t n_cols;
+	size_t n_widest;
 	size_t n_bytes;
+	size_t n_alloc;
 	size_t n_codepoints;
+	bool gap_buffer;
 	bool failed;
 };
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+/* a string and its cache are allocated together */
+
+struct _block_t
+{
+	cobj_string_t str;
+	_cache_t cache;
+};
+
+typedef struct _block_t _block_t;
+
 /************************************************************************************************************/
 /************************************************************************************************************/
 /************************************************************************************************************/
 
+static size_t       _convert_coords         (const cobj_string_t *str, size_t row, size_t col, size_t *byte);
 static size_t       _convert_to_byte_offset (const cobj_string_t *str, size_t offset);
+static const char * _copy_span              (const cobj_string_t *str, size_t byte, size_t n);
+static char *       _create_buffer          (size_t n);
+static void *       _extend                 (void *array, size_t *n_alloc, size_t size);
+static size_t       _find_checkpoint        (const cobj_string_t *str, size_t index);
+static size_t       _find_newline           (const cobj_string_t *str, size_t byte);
+static _row_t       _find_row               (const cobj_string_t *str, size_t row);
+static bool         _flatten                (const cobj_string_t *str);
+static void         _free_spans             (_cache_t *cache);
+static _buffer_t *  _get_buffer             (char *chars);
+static char *       _get_byte               (const cobj_string_t *str, size_t byte);
+static const char * _get_chars              (const cobj_string_t *str);
+static size_t       _get_gap                (const cobj_string_t *str);
+static size_t       _get_head               (const cobj_string_t *str);
 static const char * _get_next_codepoint     (const char *codepoint);
+static void         _invalidate             (cobj_string_t *str, size_t byte);
+static size_t       _invalidate_array       (const void *array, size_t n, size_t size, size_t byte);
+static bool         _is_aliased             (const cobj_string_t *str, const char *c_str);
 static bool         _is_end_byte            (char c);
+static bool         _is_shared              (const cobj_string_t *str);
+static void         _move_gap               (const cobj_string_t *str, size_t byte);
+static void         _release                (cobj_string_t *str);
+static void         _rescan_widths          (cobj_string_t *str);
+static bool         _reserve                (cobj_string_t *str, size_t n);
+static bool         _resize                 (cobj_string_t *str, size_t n);
+static size_t       _seek                   (const cobj_string_t *str, size_t byte, size_t n_codepoints);
+static void         _share                  (cobj_string_t *str, const cobj_string_t *str_src);
+static size_t       _test_wrap              (const char *chars, size_t n, size_t max_cols);
+static void         _track_rows             (cobj_string_t *str, size_t a, size_t b, bool add);
+static void         _track_width            (cobj_string_t *str, size_t col, bool add);
+static void         _track_widths           (cobj_string_t *str, size_t a, size_t b, bool add);
 static void         _update_n_values        (cobj_string_t *str);
 
 /************************************************************************************************************/
@@ -58,10 +181,15 @@ static void         _update_n_values        (cobj_string_t *str);
 static cobj_string_t _err_str =
 {
 	.chars        = NULL,
+	.rope         = NULL,
+	.cache        = NULL,
 	.n_rows       = 0,
 	.n_cols       = 0,
+	.n_widest     = 0,
 	.n_bytes      = 0,
+	.n_alloc      = 0,
 	.n_codepoints = 0,
+	.gap_buffer   = false,
 	.failed       = true,
 };
 
@@ -105,7 +233,7 @@ cobj_string_clone(const cobj_string_t *str)
 
 	assert(str);
 
-	str_dup = cobj_string_create();
+	str_dup = cobj_string_create_backend(cobj_string_get_backend(str));
 
 	cobj_string_set(str_dup, str);
 
@@ -117,8 +245,7 @@ cobj_string_clone(const cobj_string_t *str)
 size_t
 cobj_string_convert_coords_to_offset(const cobj_string_t *str, size_t row, size_t col)
 {
-	const char *codepoint;
-	size_t offset = 0;
+	size_t byte;
 
 	assert(str);
 
@@ -127,49 +254,7 @@ cobj_string_convert_coords_to_offset(const cobj_string_t *str, size_t row, size_
 		return 0;
 	}
 
-	if (row >= str->n_rows)
-	{
-		row = str->n_rows - 1;
-	}
-
-	if (col > str->n_cols)
-	{
-		col = str->n_cols;
-	}
-
-	codepoint = str->chars;
-
-	/* skip rows */
-
-	while (row > 0)
-	{
-		if (*codepoint == '\n')
-		{
-			row--;
-		}
-		codepoint = _get_next_codepoint(codepoint);
-		offset++;
-	}
-
-	/* seek until right column is reached */
-
-	while (col > 0)
-	{
-		switch (*codepoint)
-		{
-			case '\0':
-			case '\n':
-				return offset;
-
-			default:
-				break;
-		}
-		codepoint = _get_next_codepoint(codepoint);
-		offset++;
-		col--;
-	}
-
-	return offset;
+	return _convert_coords(str, row, col, &byte);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -193,8 +278,8 @@ cobj_string_convert_wrapped_offset(const cobj_string_t *str, const cobj_string_t
 		return str->n_codepoints;
 	}
 
-	codepoint_1 = str->chars;
-	codepoint_2 = str_wrap->chars;
+	codepoint_1 = _get_chars(str);
+	codepoint_2 = _get_chars(str_wrap);
 
 	for (size_t i = 0; i < offset; i++)
 	{
@@ -217,19 +302,54 @@ cobj_string_convert_wrapped_offset(const cobj_string_t *str, const cobj_string_t
 
 cobj_string_t *
 cobj_string_create(void)
+{
+	return cobj_string_create_backend(COBJ_STRING_CONTIGUOUS);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cobj_string_t *
+cobj_string_create_backend(cobj_string_backend_t backend)
 {
 	cobj_string_t *str;
+	_block_t      *block;
+
+	if (!(block = malloc(sizeof(_block_t))))
+	{
+		return &_err_str;
+	}
+
+	str        = &block->str;
+	str->cache = &block->cache;
+	str->rope  = NULL;
 
-	if (!(str = malloc(sizeof(cobj_string_t))))
+	if (backend == COBJ_STRING_ROPE && !(str->rope = rope_create()))
 	{
+		free(block);
 		return &_err_str;
 	}
 
-	str->chars        = NULL;
+	str->cache->rows                = NULL;
+	str->cache->n_rows              = 0;
+	str->cache->n_alloc_rows        = 0;
+	str->cache->checkpoints         = NULL;
+	str->cache->n_checkpoints       = 0;
+	str->cache->n_alloc_checkpoints = 0;
+	str->cache->flat                = NULL;
+	str->cache->n_alloc_flat        = 0;
+	str->cache->flat_valid          = false;
+	str->cache->spans               = NULL;
+	str->cache->n_tail              = 0;
+	str->cache->n_tail_codepoints   = 0;
+
+	str->chars        = str->chars_inline;
 	str->n_rows       = 0;
 	str->n_cols       = 0;
+	str->n_widest     = 0;
 	str->n_bytes      = 0;
+	str->n_alloc      = _INLINE;
 	str->n_codepoints = 0;
+	str->gap_buffer   = backend == COBJ_STRING_GAP;
 	str->failed       = false;
 
 	cobj_string_clear(str);
@@ -260,6 +380,7 @@ void
 cobj_string_cut(cobj_string_t *str, size_t offset, size_t n_codepoints)
 {
 	size_t offset_2;
+	size_t n_rows;
 
 	assert(str);
 
@@ -278,12 +399,53 @@ cobj_string_cut(cobj_string_t *str, size_t offset, size_t n_codepoints)
 		n_codepoints = str->n_codepoints - offset;
 	}
 
+	if (str->rope)
+	{
+		if (!rope_cut(str->rope, offset, n_codepoints))
+		{
+			str->failed = true;
+			return;
+		}
+		_update_n_values(str);
+		return;
+	}
+
+	/* shared content gets copied before being modified */
+
+	if (!_reserve(str, str->n_bytes))
+	{
+		return;
+	}
+
 	offset_2 = _convert_to_byte_offset(str, offset + n_codepoints);
 	offset   = _convert_to_byte_offset(str, offset);
 
-	memmove(str->chars + offset, str->chars + offset_2, str->n_bytes - offset_2);
+	if (str->gap_buffer)
+	{
+		_move_gap(str, offset);
+	}
+
+	_invalidate(str, offset);
+	_track_widths(str, offset, offset_2, false);
+	n_codepoints = utf8_count(_get_byte(str, offset), offset_2 - offset, &n_rows);
 
-	_update_n_values(str);
+	/* cut bytes right after a gap are simply absorbed by it */
+
+	if (str->gap_buffer)
+	{
+		str->cache->n_tail            -= offset_2 - offset;
+		str->cache->n_tail_codepoints -= n_codepoints;
+	}
+	else
+	{
+		memmove(str->chars + offset, str->chars + offset_2, str->n_bytes - offset_2);
+	}
+
+	str->n_codepoints -= n_codepoints;
+	str->n_rows       -= n_rows;
+	str->n_bytes      -= offset_2 - offset;
+
+	_track_widths(str, offset, offset, true);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -298,7 +460,17 @@ cobj_string_destroy(cobj_string_t **str)
 		return;
 	}
 
-	free((*str)->chars);
+	if ((*str)->rope)
+	{
+		rope_destroy((*str)->rope);
+	}
+
+	_release(*str);
+	_free_spans((*str)->cache);
+
+	free((*str)->cache->rows);
+	free((*str)->cache->checkpoints);
+	free((*str)->cache->flat);
 	free(*str);
 
 	*str = &_err_str;
@@ -316,7 +488,32 @@ cobj_string_get_alloc_size(const cobj_string_t *str)
 		return 0;
 	}
 
-	return str->n_bytes;
+	if (str->rope)
+	{
+		return rope_get_alloc_size(str->rope) + str->cache->n_alloc_flat;
+	}
+
+	return str->n_alloc;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cobj_string_backend_t
+cobj_string_get_backend(const cobj_string_t *str)
+{
+	assert(str);
+
+	if (str->failed)
+	{
+		return COBJ_STRING_CONTIGUOUS;
+	}
+
+	if (str->rope)
+	{
+		return COBJ_STRING_ROPE;
+	}
+
+	return str->gap_buffer ? COBJ_STRING_GAP : COBJ_STRING_CONTIGUOUS;
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -331,7 +528,7 @@ cobj_string_get_chars(const cobj_string_t *str)
 		return "";
 	}
 
-	return str->chars;
+	return _get_chars(str);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -339,14 +536,18 @@ cobj_string_get_chars(const cobj_string_t *str)
 const char *
 cobj_string_get_chars_at_coords(const cobj_string_t *str, size_t row, size_t col)
 {
+	size_t byte;
+
 	assert(str);
 
-	if (str->failed)
+	if (str->failed || !_flatten(str))
 	{
 		return "";
 	}
 
-	return str->chars + _convert_to_byte_offset(str, cobj_string_convert_coords_to_offset(str, row, col));
+	_convert_coords(str, row, col, &byte);
+
+	return _get_chars(str) + byte;
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -356,12 +557,12 @@ cobj_string_get_chars_at_offset(const cobj_string_t *str, size_t offset)
 {
 	assert(str);
 
-	if (str->failed)
+	if (str->failed || !_flatten(str))
 	{
 		return "";
 	}
 
-	return str->chars + _convert_to_byte_offset(str, offset);
+	return _get_chars(str) + _convert_to_byte_offset(str, offset);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -396,6 +597,92 @@ cobj_string_get_length(const cobj_string_t *str)
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
+cobj_string_view_t
+cobj_string_get_view(const cobj_string_t *str, size_t offset, size_t n_codepoints)
+{
+	cobj_string_view_t view = {.chars = "", .n_bytes = 0, .n_codepoints = 0};
+
+	size_t byte;
+	size_t byte_end;
+	size_t gap;
+
+	assert(str);
+
+	if (str->failed)
+	{
+		return view;
+	}
+
+	if (offset > str->n_codepoints)
+	{
+		offset = str->n_codepoints;
+	}
+
+	if (n_codepoints > str->n_codepoints - offset)
+	{
+		n_codepoints = str->n_codepoints - offset;
+	}
+
+	view.n_codepoints = n_codepoints;
+
+	if (n_codepoints == 0)
+	{
+		return view;
+	}
+
+	/* rope ranges that fit within a single node are pointed at directly, ranges that span several nodes */
+	/* are copied on their own, unless they cover most of the content and it's cheaper to flatten it */
+
+	if (str->rope && !str->cache->flat_valid && (view.chars = rope_get_span(str->rope, offset, n_codepoints,
+		&view.n_bytes)))
+	{
+		return view;
+	}
+
+	if (str->rope)
+	{
+		byte     = _convert_to_byte_offset(str, offset);
+		byte_end = _convert_to_byte_offset(str, offset + n_codepoints);
+
+		if (str->cache->flat_valid || byte_end - byte >= str->n_bytes / 2)
+		{
+			view.chars = _flatten(str) ? str->cache->flat + byte : NULL;
+		}
+		else
+		{
+			view.chars = _copy_span(str, byte, byte_end - byte);
+		}
+
+		if (!view.chars)
+		{
+			return (cobj_string_view_t){.chars = "", .n_bytes = 0, .n_codepoints = 0};
+		}
+
+		view.n_bytes = byte_end - byte;
+
+		return view;
+	}
+
+	/* both ends are found from the checkpoint index, so no part of the content gets scanned twice, a gap */
+	/* inside the range is moved to its closest end, which costs at most the length of the range */
+
+	byte     = _convert_to_byte_offset(str, offset);
+	byte_end = _convert_to_byte_offset(str, offset + n_codepoints);
+	gap      = _get_gap(str);
+
+	if (byte < gap && gap < byte_end)
+	{
+		_move_gap(str, gap - byte < byte_end - gap ? byte : byte_end);
+	}
+
+	view.chars   = _get_byte(str, byte);
+	view.n_bytes = byte_end - byte;
+
+	return view;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
 cobj_string_t *
 cobj_string_get_placeholder(void)
 {
@@ -439,7 +726,7 @@ cobj_string_insert(cobj_string_t *str, const cobj_string_t *str_src, size_t offs
 		return;
 	}
 
-	cobj_string_insert_raw(str, str_src->chars, offset);
+	cobj_string_insert_raw(str, _get_chars(str_src), offset);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -448,7 +735,10 @@ void
 cobj_string_insert_raw(cobj_string_t *str, const char *c_str, size_t offset)
 {
 	size_t n;
-	char *tmp;
+	size_t n_total;
+	size_t n_codepoints;
+	size_t n_rows;
+	char *tmp = NULL;
 
 	assert(str);
 
@@ -462,27 +752,70 @@ cobj_string_insert_raw(cobj_string_t *str, const char *c_str, size_t offset)
 		return;
 	}
 
-	if (!safe_add(NULL, n = strlen(c_str), str->n_bytes))
+	if (!safe_add(&n_total, n = strlen(c_str), str->n_bytes))
 	{
 		str->failed = true;
 		return;
 	}
 
-	if (!(tmp = malloc(str->n_bytes + n)))
+	/* the flattened copy a rope source may come from is left untouched until the next read */
+
+	if (str->rope)
 	{
-		str->failed = true;
+		if (!rope_insert(str->rope, offset < str->n_codepoints ? offset : str->n_codepoints, c_str, n))
+		{
+			str->failed = true;
+			return;
+		}
+		_update_n_values(str);
+		return;
+	}
+
+	/* the source may point into the string's own buffer, which is about to be moved or reallocated */
+
+	if (_is_aliased(str, c_str))
+	{
+		if (!(tmp = malloc(n)))
+		{
+			str->failed = true;
+			return;
+		}
+		c_str = memcpy(tmp, c_str, n);
+	}
+
+	if (!_reserve(str, n_total))
+	{
+		free(tmp);
 		return;
 	}
 
 	offset = _convert_to_byte_offset(str, offset);
 
-	memcpy(tmp,              str->chars,          offset);
-	memcpy(tmp + offset,     c_str,               n);
-	memcpy(tmp + offset + n, str->chars + offset, str->n_bytes - offset);
+	/* a gap buffer only moves the bytes between its gap and the edit point, new text then fills the gap */
 
-	free(str->chars);
-	str->chars = tmp;
-	_update_n_values(str);
+	if (str->gap_buffer)
+	{
+		_move_gap(str, offset);
+	}
+
+	_invalidate(str, offset);
+	_track_widths(str, offset, offset, false);
+	n_codepoints = utf8_count(c_str, n, &n_rows);
+
+	if (!str->gap_buffer)
+	{
+		memmove(str->chars + offset + n, str->chars + offset, str->n_bytes - offset);
+	}
+
+	memcpy(str->chars + offset, c_str, n);
+
+	str->n_codepoints += n_codepoints;
+	str->n_rows       += n_rows;
+	str->n_bytes      += n;
+
+	_track_widths(str, offset, offset + n, true);
+
+	free(tmp);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -567,8 +900,6 @@ cobj_string_prepend_raw(cobj_string_t *str, const char *c_str)
 void
 cobj_string_realloc(cobj_string_t *str)
 {
-	char *tmp;
-
 	assert(str);
 
 	if (str->failed)
@@ -576,13 +907,44 @@ cobj_string_realloc(cobj_string_t *str)
 		return;
 	}
 
-	if (!(tmp = realloc(str->chars, str->n_bytes)))
+	/* for ropes, the flattened copy is the only buffer that can be trimmed, it gets rebuilt on next read */
+
+	if (str->rope)
+	{
+		free(str->cache->flat);
+		str->cache->flat         = NULL;
+		str->cache->n_alloc_flat = 0;
+		str->cache->flat_valid   = false;
+		_free_spans(str->cache);
+		return;
+	}
+
+	/* trimming a shared buffer would mean duplicating it */
+
+	if (_is_shared(str))
+	{
+		return;
+	}
+
+	_resize(str, str->n_bytes);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_string_reserve(cobj_string_t *str, size_t n_bytes)
+{
+	assert(str);
+
+	if (str->failed || str->rope)
 	{
-		str->failed = true;
 		return;
 	}
 
-	str->chars = tmp;
+	if (n_bytes > str->n_alloc)
+	{
+		_resize(str, n_bytes);
+	}
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -610,7 +972,15 @@ cobj_string_set(cobj_string_t *str, const cobj_string_t *str_src)
 		return;
 	}
 
-	cobj_string_set_raw(str, str_src->chars);
+	/* heap content is shared rather than copied, which makes clones O(1) until one of them gets modified */
+
+	if (!str->rope && !str_src->rope && str_src->chars != str_src->chars_inline)
+	{
+		_share(str, str_src);
+		return;
+	}
+
+	cobj_string_set_raw(str, _get_chars(str_src));
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -618,7 +988,8 @@ cobj_string_set(cobj_string_t *str, const cobj_string_t *str_src)
 void
 cobj_string_set_raw(cobj_string_t *str, const char *c_str)
 {
-	char *tmp;
+	size_t n;
+	size_t byte = SIZE_MAX;
 
 	assert(str);
 
@@ -632,16 +1003,40 @@ cobj_string_set_raw(cobj_string_t *str, const char *c_str)
 		c_str = "";
 	}
 
-	if (!(tmp = malloc(strlen(c_str) + 1)))
+	if (str->rope)
+	{
+		rope_clear(str->rope);
+		if (!rope_insert(str->rope, 0, c_str, strlen(c_str)))
+		{
+			str->failed = true;
+			return;
+		}
+		_update_n_values(str);
+		return;
+	}
+
+	/* an aliased source is a suffix of the current content, so it already fits, but the content may still */
+	/* get copied out of a shared buffer, so the source is found again from its position */
+
+	_move_gap(str, str->n_bytes);
+
+	if (_is_aliased(str, c_str))
+	{
+		byte = (size_t)(c_str - str->chars);
+	}
+
+	if (!_reserve(str, n = strlen(c_str) + 1))
 	{
-		str->failed = true;
 		return;
 	}
 
-	strcpy(tmp, c_str);
+	if (byte != SIZE_MAX)
+	{
+		c_str = str->chars + byte;
+	}
+
+	memmove(str->chars, c_str, n);
 
-	free(str->chars);
-	str->chars = tmp;
 	_update_n_values(str);
 }
 
@@ -675,10 +1070,6 @@ cobj_string_slice(cobj_string_t *str, size_t offset, size_t n_codepoints)
 size_t
 cobj_string_test_wrap(const cobj_string_t *str, size_t max_cols)
 {
-	size_t row = 1;
-	size_t col = 0;
-	size_t n   = 0;
-
 	assert(str && max_cols > 0);
 
 	if (str->failed)
@@ -691,27 +1082,12 @@ cobj_string_test_wrap(const cobj_string_t *str, size_t max_cols)
 		return str->n_rows;
 	}
 
-	for (const char *codepoint = str->chars; *codepoint != '\0'; n++)
+	if (!_flatten(str))
 	{
-		if (*codepoint == '\n')
-		{
-			col = 0;
-			row++;
-		}
-		else if (col == max_cols)
-		{
-			col = 1;
-			row++;
-		}
-		else
-		{
-			col++;
-		}
-
-		codepoint = _get_next_codepoint(codepoint);
+		return 0;
 	}
 
-	return row;
+	return _test_wrap(_get_chars(str), str->n_bytes - 1, max_cols);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -719,6 +1095,8 @@ cobj_string_test_wrap(const cobj_string_t *str, size_t max_cols)
 void
 cobj_string_trim(cobj_string_t *str)
 {
+	const char *chars;
+
 	assert(str);
 
 	if (str->failed)
@@ -728,9 +1106,17 @@ cobj_string_trim(cobj_string_t *str)
 
 	/* leading whitespaces */
 
+	if (!_flatten(str))
+	{
+		str->failed = true;
+		return;
+	}
+
+	chars = _get_chars(str);
+
 	for (size_t i = 0;; i++)
 	{
-		switch (str->chars[i])
+		switch (chars[i])
 		{
 			case '\v':
 			case '\t':
@@ -752,9 +1138,17 @@ exit_lead:
 		return;
 	}
 
+	if (!_flatten(str))
+	{
+		str->failed = true;
+		return;
+	}
+
+	chars = _get_chars(str);
+
 	for (size_t i = str->n_bytes - 2;; i--)
 	{
-		switch (str->chars[i])
+		switch (chars[i])
 		{
 			case '\v':
 			case '\t':
@@ -770,6 +1164,111 @@ exit_lead:
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
+int
+cobj_string_view_compare(cobj_string_view_t view_1, cobj_string_view_t view_2)
+{
+	size_t n;
+	int    diff;
+
+	/* byte order matches codepoint order in UTF-8, so the comparison needs no decoding */
+
+	n = view_1.n_bytes < view_2.n_bytes ? view_1.n_bytes : view_2.n_bytes;
+
+	if (n > 0 && (diff = memcmp(view_1.chars, view_2.chars, n)) != 0)
+	{
+		return diff;
+	}
+
+	return (view_1.n_bytes > view_2.n_bytes) - (view_1.n_bytes < view_2.n_bytes);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+cobj_string_view_find(cobj_string_view_t view, cobj_string_view_t pattern, size_t *offset)
+{
+	const char *match;
+	const char *end;
+
+	if (pattern.n_bytes > view.n_bytes)
+	{
+		return false;
+	}
+
+	/* UTF-8 is self-synchronizing, so a byte match always starts on a codepoint boundary */
+
+	match = view.chars;
+	end   = view.chars + view.n_bytes - pattern.n_bytes;
+
+	if (pattern.n_bytes > 0)
+	{
+		for (; (match = memchr(match, pattern.chars[0], end - match + 1)); match++)
+		{
+			if (memcmp(match, pattern.chars, pattern.n_bytes) == 0)
+			{
+				break;
+			}
+		}
+	}
+
+	if (!match)
+	{
+		return false;
+	}
+
+	if (offset)
+	{
+		*offset = utf8_count(view.chars, match - view.chars, NULL);
+	}
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+uint64_t
+cobj_string_view_hash(cobj_string_view_t view)
+{
+	const uint64_t prime = 1099511628211ULL;
+
+	uint64_t h = 14695981039346656037ULL;
+
+	/* FNV-1A */
+
+	for (size_t i = 0; i < view.n_bytes; i++)
+	{
+		h = (h ^ (uint8_t)view.chars[i]) * prime;
+	}
+
+	return h;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cobj_string_view_t
+cobj_string_view_raw(const char *c_str)
+{
+	cobj_string_view_t view;
+
+	view.chars        = c_str ? c_str : "";
+	view.n_bytes      = strlen(view.chars);
+	view.n_codepoints = utf8_count(view.chars, view.n_bytes, NULL);
+
+	return view;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+cobj_string_view_test_wrap(cobj_string_view_t view, size_t max_cols)
+{
+	assert(max_cols > 0);
+
+	return _test_wrap(view.chars, view.n_bytes, max_cols);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
 void
 cobj_string_wrap(cobj_string_t *str, size_t max_cols)
 {
@@ -777,9 +1276,12 @@ cobj_string_wrap(cobj_string_t *str, size_t max_cols)
 	size_t max_rows;
 	size_t max_bytes;
 	size_t col;
+	size_t n;
 	char  *tmp;
 	bool   safe = true;
 
+	const char *chars;
+
 	assert(str && max_cols > 0);
 
 	if (str->failed)
@@ -811,141 +1313,872 @@ cobj_string_wrap(cobj_string_t *str, size_t max_cols)
 
 	/* alloc memory */
 
-	if (!(tmp = malloc(max_bytes)))
+	if (!_flatten(str) || !(tmp = _create_buffer(max_bytes)))
 	{
 		str->failed = true;
 		return;
 	}
 
-	/* wrap string */
+	chars = _get_chars(str);
 
-	str->n_cols       = max_cols;
-	str->n_rows       = 1;
-	str->n_bytes      = 0;
-	str->n_codepoints = 0;
+	/* wrap string */
 
 	col = 0;
+	n   = 0;
 
 	for (size_t i = 0;; i++)
 	{
-		if (_is_end_byte(str->chars[i]))
+		if (_is_end_byte(chars[i]))
 		{
-			if (str->chars[i] == '\0')
+			if (chars[i] == '\0')
 			{
-				tmp[str->n_bytes++] = str->chars[i];
+				tmp[n++] = chars[i];
 				break;
 			}
-			else if (str->chars[i] == '\n')
+			else if (chars[i] == '\n')
 			{
-				str->n_rows++;
 				col = 0;
 			}
 			else if (col == max_cols)
 			{
-				tmp[str->n_bytes++] = '\n';
-				str->n_rows++;
+				tmp[n++] = '\n';
 				col = 1;
 			}
 			else
 			{
 				col++;
 			}
-			str->n_codepoints++;
 		}
-		tmp[str->n_bytes++] = str->chars[i];
+		tmp[n++] = chars[i];
+	}
+
+	if (str->rope)
+	{
+		cobj_string_set_raw(str, tmp);
+		free(_get_buffer(tmp));
+		return;
 	}
 
-	free(str->chars);
-	str->chars = tmp;
+	_release(str);
+
+	str->chars   = tmp;
+	str->n_alloc = max_bytes;
+	_update_n_values(str);
 }
 
 /************************************************************************************************************/
 /* _ ********************************************************************************************************/
 /************************************************************************************************************/
 
+static size_t
+_convert_coords(const cobj_string_t *str, size_t row, size_t col, size_t *byte)
+{
+	const char *end;
+	_row_t      start;
+	size_t      n;
+	size_t      i;
+
+	if (row >= str->n_rows)
+	{
+		row = str->n_rows - 1;
+	}
+
+	/* ropes aggregate newlines per node, so row starts are found by descending the tree instead */
+
+	if (str->rope)
+	{
+		rope_get_row(str->rope, row, &start.byte, &start.codepoint);
+		if (row + 1 < str->n_rows)
+		{
+			rope_get_row(str->rope, row + 1, &i, &n);
+			n -= start.codepoint + 1;
+		}
+		else
+		{
+			n = str->n_codepoints - start.codepoint;
+		}
+		col   = col < n ? col : n;
+		*byte = rope_get_byte(str->rope, start.codepoint + col);
+		return start.codepoint + col;
+	}
+
+	_move_gap(str, str->n_bytes);
+
+	start = _find_row(str, row);
+
+	/* seek until right column is reached, without going past the end of the row */
+
+	n = (end = memchr(str->chars + start.byte, '\n', str->n_bytes - 1 - start.byte))
+		? (size_t)(end - str->chars) - start.byte
+		: str->n_bytes - 1 - start.byte;
+
+	if ((i = utf8_seek(str->chars + start.byte, n, col)) == n)
+	{
+		col = utf8_count(str->chars + start.byte, n, NULL);
+	}
+
+	*byte = start.byte + i;
+
+	return start.codepoint + col;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
 static size_t
 _convert_to_byte_offset(const cobj_string_t *str, size_t offset)
 {
-	size_t i = 0;
+	size_t offset_gap;
+	size_t byte;
 
 	if (offset >= str->n_codepoints)
 	{
 		return str->n_bytes - 1;
 	}
 
-	while (offset > 0)
+	if (str->rope)
 	{
-		if (_is_end_byte(str->chars[i]))
-		{
-			offset--;
-		}
-		i++;
+		return rope_get_byte(str->rope, offset);
 	}
 
-	return i;
+	/* codepoints right after the gap are sought from it, so edits near the gap stay cheap, the others go */
+	/* through the checkpoints, that are laid on both sides of the gap */
+
+	offset_gap = str->n_codepoints + 1 - str->cache->n_tail_codepoints;
+
+	if (offset >= offset_gap && offset - offset_gap < _CHECKPOINT)
+	{
+		byte = _get_gap(str);
+		return byte + utf8_seek(_get_byte(str, byte), str->cache->n_tail - 1, offset - offset_gap);
+	}
+
+	byte = _find_checkpoint(str, offset / _CHECKPOINT);
+
+	return _seek(str, byte, offset % _CHECKPOINT);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
 static const char *
-_get_next_codepoint(const char *codepoint)
+_copy_span(const cobj_string_t *str, size_t byte, size_t n)
 {
-	if (*codepoint != '\0')
+	_span_t *span;
+
+	if (!(span = malloc(sizeof(_span_t) + n)))
 	{
-		do
+		return NULL;
+	}
+
+	rope_copy(str->rope, byte, n, span->chars);
+
+	span->next        = str->cache->spans;
+	str->cache->spans = span;
+
+	return span->chars;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static char *
+_create_buffer(size_t n)
+{
+	_buffer_t *buffer;
+
+	if (!safe_add(&n, n, offsetof(_buffer_t, chars)) || !(buffer = malloc(n)))
+	{
+		return NULL;
+	}
+
+	refs_init(&buffer->n_refs, 1);
+
+	return buffer->chars;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void *
+_extend(void *array, size_t *n_alloc, size_t size)
+{
+	size_t n;
+
+	/* grows a cache array geometrically, NULL is returned if it can't, leaving the array untouched */
+
+	n = *n_alloc ? *n_alloc * 2 : 16;
+
+	if (n > SIZE_MAX / size || !(array = realloc(array, n * size)))
+	{
+		return NULL;
+	}
+
+	*n_alloc = n;
+
+	return array;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+_find_checkpoint(const cobj_string_t *str, size_t index)
+{
+	_cache_t *cache = str->cache;
+	size_t   *tmp;
+	size_t    byte  = 0;
+	size_t    i;
+
+	/* the cache holds the byte offsets of every _CHECKPOINT-th codepoint, starting from the first multiple, */
+	/* it gets extended up to the requested one like the rows cache */
+
+	i = index < cache->n_checkpoints ? index : cache->n_checkpoints;
+
+	if (i > 0)
+	{
+		byte = cache->checkpoints[i - 1];
+	}
+
+	for (; i < index; i++)
+	{
+		byte = _seek(str, byte, _CHECKPOINT);
+
+		if (i != cache->n_checkpoints)
 		{
-			codepoint++;
+			continue;
 		}
-		while (!_is_end_byte(*codepoint));
+
+		if (cache->n_checkpoints == cache->n_alloc_checkpoints)
+		{
+			if (!(tmp = _extend(cache->checkpoints, &cache->n_alloc_checkpoints, sizeof(size_t))))
+			{
+				continue;
+			}
+			cache->checkpoints = tmp;
+		}
+
+		cache->checkpoints[cache->n_checkpoints++] = byte;
 	}
 
-	return codepoint;
+	return byte;
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-static bool
-_is_end_byte(char c)
+static size_t
+_find_newline(const cobj_string_t *str, size_t byte)
 {
-	return !!(((uint8_t)c >> 6) ^ 0x02); /* bitmask = 10xxxxxx */
+	const char *end;
+	size_t      head  = _get_head(str);
+	size_t      n_gap = str->n_alloc - str->n_bytes;
+
+	/* first newline at or after the given byte, or the null byte if there is none, searched on both sides */
+	/* of the gap */
+
+	if (byte < head)
+	{
+		if ((end = memchr(str->chars + byte, '\n', head - byte)))
+		{
+			return (size_t)(end - str->chars);
+		}
+		byte = head;
+	}
+
+	if ((end = memchr(str->chars + byte + n_gap, '\n', str->n_bytes - 1 - byte)))
+	{
+		return (size_t)(end - str->chars) - n_gap;
+	}
+
+	return str->n_bytes - 1;
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-static void
-_update_n_values(cobj_string_t *str)
+static _row_t
+_find_row(const cobj_string_t *str, size_t row)
 {
-	size_t col = 0;
+	_cache_t   *cache = str->cache;
+	_row_t     *tmp;
+	_row_t      start = {0};
+	const char *end;
+	size_t      n;
+	size_t      i;
 
-	str->n_rows       = 1;
-	str->n_cols       = 0;
-	str->n_bytes      = 0;
-	str->n_codepoints = 0;
-	
-	for (;;)
+	/* the cache holds the starts of rows 1 to n_rows, it gets extended up to the requested row by */
+	/* walking the rows that follow the last known one, then any lookup is a direct access */
+
+	i = row < cache->n_rows ? row : cache->n_rows;
+
+	if (i > 0)
+	{
+		start = cache->rows[i - 1];
+	}
+
+	for (; i < row; i++)
 	{
-		switch (str->chars[str->n_bytes++])
+		end = memchr(str->chars + start.byte, '\n', str->n_bytes - 1 - start.byte);
+		n   = (size_t)(end - str->chars) + 1 - start.byte;
+
+		start.codepoint += utf8_count(str->chars + start.byte, n, NULL);
+		start.byte      += n;
+
+		/* out of memory is not an error here, rows just stop being cached */
+
+		if (i != cache->n_rows)
 		{
-			case '\0':
-				str->n_cols = col > str->n_cols ? col : str->n_cols;
-				return;
+			continue;
+		}
 
-			case '\n':
-				str->n_cols = col > str->n_cols ? col : str->n_cols;
-				str->n_rows++;
-				str->n_codepoints++;
-				col = 0;
-				break;
+		if (cache->n_rows == cache->n_alloc_rows)
+		{
+			if (!(tmp = _extend(cache->rows, &cache->n_alloc_rows, sizeof(_row_t))))
+			{
+				continue;
+			}
+			cache->rows = tmp;
+		}
 
-			default:
-				if (_is_end_byte(str->chars[str->n_bytes]))
-				{
-					str->n_codepoints++;
-					col++;
-				}
-				break;
+		cache->rows[cache->n_rows++] = start;
+	}
+
+	return start;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_flatten(const cobj_string_t *str)
+{
+	_cache_t *cache = str->cache;
+	char     *tmp;
+
+	/* rope content is copied into a contiguous buffer on demand, that copy stays valid until the next edit, */
+	/* while a gap buffer gets its gap closed */
+
+	if (!str->rope)
+	{
+		_move_gap(str, str->n_bytes);
+		return true;
+	}
+
+	if (cache->flat_valid)
+	{
+		return true;
+	}
+
+	if (str->n_bytes > cache->n_alloc_flat)
+	{
+		if (!(tmp = realloc(cache->flat, str->n_bytes)))
+		{
+			return false;
 		}
+		cache->flat         = tmp;
+		cache->n_alloc_flat = str->n_bytes;
 	}
+
+	rope_flatten(str->rope, cache->flat);
+
+	cache->flat[str->n_bytes - 1] = '\0';
+	cache->flat_valid             = true;
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_free_spans(_cache_t *cache)
+{
+	_span_t *span;
+
+	while ((span = cache->spans))
+	{
+		cache->spans = span->next;
+		free(span);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static _buffer_t *
+_get_buffer(char *chars)
+{
+	return (_buffer_t*)(void*)(chars - offsetof(_buffer_t, chars));
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static char *
+_get_byte(const cobj_string_t *str, size_t byte)
+{
+	/* the bytes after the gap are stored at the end of the buffer */
+
+	return str->chars + byte + (byte < _get_gap(str) ? 0 : str->n_alloc - str->n_bytes);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static const char *
+_get_chars(const cobj_string_t *str)
+{
+	/* out of memory is not an error for getters, they get an empty string instead */
+
+	if (!_flatten(str))
+	{
+		return "";
+	}
+
+	return str->rope ? str->cache->flat : str->chars;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+_get_gap(const cobj_string_t *str)
+{
+	/* a closed gap sits past the null byte, so contiguous strings always have theirs closed */
+
+	return str->n_bytes - str->cache->n_tail;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+_get_head(const cobj_string_t *str)
+{
+	size_t gap = _get_gap(str);
+
+	/* number of text bytes stored contiguously at the start of the buffer */
+
+	return gap < str->n_bytes ? gap : str->n_bytes - 1;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static const char *
+_get_next_codepoint(const char *codepoint)
+{
+	if (*codepoint != '\0')
+	{
+		do
+		{
+			codepoint++;
+		}
+		while (!_is_end_byte(*codepoint));
+	}
+
+	return codepoint;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_invalidate(cobj_string_t *str, size_t byte)
+{
+	_cache_t *cache = str->cache;
+
+	/* cached offsets at or before the edit point are unaffected by it, only the ones after are dropped */
+
+	cache->n_rows        = _invalidate_array(cache->rows,        cache->n_rows,        sizeof(_row_t), byte);
+	cache->n_checkpoints = _invalidate_array(cache->checkpoints, cache->n_checkpoints, sizeof(size_t), byte);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+_invalidate_array(const void *array, size_t n, size_t size, size_t byte)
+{
+	size_t a = 0;
+	size_t b = n;
+	size_t m;
+
+	/* binary search of the first element past the given byte offset, each element starts with that offset */
+
+	while (a < b)
+	{
+		m = a + (b - a) / 2;
+		if (*(const size_t*)((const char*)array + m * size) <= byte)
+		{
+			a = m + 1;
+		}
+		else
+		{
+			b = m;
+		}
+	}
+
+	return a;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_is_aliased(const cobj_string_t *str, const char *c_str)
+{
+	/* pointer comparisons across objects are not defined, so compare addresses as integers instead */
+
+	return (uintptr_t)c_str >= (uintptr_t)str->chars && (uintptr_t)c_str < (uintptr_t)str->chars + str->n_alloc;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_is_end_byte(char c)
+{
+	return !!(((uint8_t)c >> 6) ^ 0x02); /* bitmask = 10xxxxxx */
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_is_shared(const cobj_string_t *str)
+{
+	return str->chars != str->chars_inline && refs_load(&_get_buffer(str->chars)->n_refs) > 1;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_move_gap(const cobj_string_t *str, size_t byte)
+{
+	_cache_t *cache = str->cache;
+	size_t    gap   = _get_gap(str);
+	size_t    n_gap = str->n_alloc - str->n_bytes;
+
+	/* only the bytes between the gap and its new position are moved, moving it past the null byte closes it */
+
+	if (byte < gap)
+	{
+		cache->n_tail            += gap - byte;
+		cache->n_tail_codepoints += utf8_count(str->chars + byte, gap - byte, NULL);
+		memmove(str->chars + byte + n_gap, str->chars + byte, gap - byte);
+	}
+	else if (byte > gap)
+	{
+		cache->n_tail            -= byte - gap;
+		cache->n_tail_codepoints -= utf8_count(str->chars + gap + n_gap, byte - gap, NULL);
+		memmove(str->chars + gap, str->chars + gap + n_gap, byte - gap);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_release(cobj_string_t *str)
+{
+	/* drops this string's hold on its heap buffer, which is freed once no other string shares it */
+
+	if (str->chars != str->chars_inline && refs_decrement(&_get_buffer(str->chars)->n_refs) == 0)
+	{
+		free(_get_buffer(str->chars));
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_rescan_widths(cobj_string_t *str)
+{
+	str->n_cols   = 0;
+	str->n_widest = 0;
+
+	_track_rows(str, 0, str->n_bytes - 1, true);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_reserve(cobj_string_t *str, size_t n)
+{
+	size_t n_alloc;
+
+	/* capacity doubles so that repeated appends only cost O(1) amortized copies and allocations, a shared */
+	/* buffer is copied even if it is large enough, since it is about to be modified */
+
+	if (n <= str->n_alloc)
+	{
+		return _is_shared(str) ? _resize(str, str->n_alloc) : true;
+	}
+
+	if (!safe_mul(&n_alloc, str->n_alloc, 2) || n_alloc < n)
+	{
+		n_alloc = n;
+	}
+
+	return _resize(str, n_alloc);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_resize(cobj_string_t *str, size_t n)
+{
+	_buffer_t *buffer;
+	size_t     size;
+	char      *tmp;
+
+	/* the gap is sized after the allocation, so it has to be closed before it changes */
+
+	_move_gap(str, str->n_bytes);
+
+	/* short content goes back to the embedded buffer, the heap is only used past its size */
+
+	if (n <= _INLINE)
+	{
+		if (str->chars != str->chars_inline)
+		{
+			memcpy(str->chars_inline, str->chars, str->n_bytes);
+			_release(str);
+			str->chars = str->chars_inline;
+		}
+		str->n_alloc = _INLINE;
+		return true;
+	}
+
+	/* a shared buffer is left to the other strings, this one moves to a copy */
+
+	tmp = NULL;
+
+	if (str->chars == str->chars_inline || _is_shared(str))
+	{
+		if ((tmp = _create_buffer(n)))
+		{
+			memcpy(tmp, str->chars, str->n_bytes);
+			_release(str);
+		}
+	}
+	else if (safe_add(&size, n, offsetof(_buffer_t, chars)) && (buffer = realloc(_get_buffer(str->chars), size)))
+	{
+		tmp = buffer->chars;
+	}
+
+	if (!tmp)
+	{
+		str->failed = true;
+		return false;
+	}
+
+	str->chars   = tmp;
+	str->n_alloc = n;
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+_seek(const cobj_string_t *str, size_t byte, size_t n_codepoints)
+{
+	size_t head = _get_head(str);
+	size_t n;
+
+	/* byte offset of the n-th codepoint after the given byte offset, the seek goes on past the gap */
+
+	if (byte < head)
+	{
+		if ((n = utf8_seek(str->chars + byte, head - byte, n_codepoints)) < head - byte)
+		{
+			return byte + n;
+		}
+		n_codepoints -= utf8_count(str->chars + byte, head - byte, NULL);
+		byte          = head;
+	}
+
+	return byte + utf8_seek(_get_byte(str, byte), str->n_bytes - 1 - byte, n_codepoints);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_share(cobj_string_t *str, const cobj_string_t *str_src)
+{
+	if (str->failed)
+	{
+		return;
+	}
+
+	/* the source's gap is closed so that the shared content is never modified by any of its owners, and */
+	/* the new reference is taken first in case both strings already share the same buffer */
+
+	_move_gap(str_src, str_src->n_bytes);
+
+	refs_increment(&_get_buffer(str_src->chars)->n_refs);
+
+	_release(str);
+
+	str->chars        = str_src->chars;
+	str->n_alloc      = str_src->n_alloc;
+	str->n_bytes      = str_src->n_bytes;
+	str->n_codepoints = str_src->n_codepoints;
+	str->n_rows       = str_src->n_rows;
+	str->n_cols       = str_src->n_cols;
+	str->n_widest     = str_src->n_widest;
+
+	str->cache->n_tail            = 0;
+	str->cache->n_tail_codepoints = 0;
+
+	_invalidate(str, 0);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+_test_wrap(const char *chars, size_t n, size_t max_cols)
+{
+	size_t row = 1;
+	size_t col = 0;
+
+	/* continuation bytes are skipped, every other byte starts a codepoint */
+
+	for (size_t i = 0; i < n; i++)
+	{
+		if (!_is_end_byte(chars[i]))
+		{
+			continue;
+		}
+
+		if (chars[i] == '\n')
+		{
+			col = 0;
+			row++;
+		}
+		else if (col == max_cols)
+		{
+			col = 1;
+			row++;
+		}
+		else
+		{
+			col++;
+		}
+	}
+
+	return row;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_track_rows(cobj_string_t *str, size_t a, size_t b, bool add)
+{
+	const char *row;
+	const char *end;
+	const char *next;
+	size_t      head  = _get_head(str);
+	size_t      width = 0;
+	size_t      bounds[3];
+
+	/* widths of the rows found in the byte range [a, b), one vectorized count per row, the parts of the */
+	/* range before and after the gap are walked in turn, a row crossing the gap is counted in two parts */
+
+	bounds[0] = a;
+	bounds[1] = head < a ? a : (head > b ? b : head);
+	bounds[2] = b;
+
+	for (size_t i = 0; i < 2; i++)
+	{
+		if (bounds[i] == bounds[i + 1])
+		{
+			continue;
+		}
+
+		row = _get_byte(str, bounds[i]);
+		end = row + bounds[i + 1] - bounds[i];
+
+		for (; (next = memchr(row, '\n', end - row)); row = next + 1)
+		{
+			_track_width(str, width + utf8_count(row, next - row, NULL), add);
+			width = 0;
+		}
+
+		width += utf8_count(row, end - row, NULL);
+	}
+
+	_track_width(str, width, add);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_track_width(cobj_string_t *str, size_t col, bool add)
+{
+	if (!add)
+	{
+		if (col == str->n_cols)
+		{
+			str->n_widest--;
+		}
+	}
+	else if (col > str->n_cols)
+	{
+		str->n_cols   = col;
+		str->n_widest = 1;
+	}
+	else if (col == str->n_cols)
+	{
+		str->n_widest++;
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_track_widths(cobj_string_t *str, size_t a, size_t b, bool add)
+{
+	/* n_cols is the widest row and n_widest the number of rows that wide, both are updated from the rows */
+	/* overlapping the byte range [a, b] only, a full rescan is only needed once all the widest rows are gone */
+
+	/* a single row spans the whole string, so its width is already known without scanning it */
+
+	if (str->n_rows == 1)
+	{
+		str->n_cols   = add ? str->n_codepoints : str->n_cols;
+		str->n_widest = add ? 1 : 0;
+		return;
+	}
+
+	while (a > 0 && str->chars[a - 1] != '\n')
+	{
+		a--;
+	}
+
+	b = _find_newline(str, b);
+
+	_track_rows(str, a, b, add);
+
+	if (add && str->n_widest == 0)
+	{
+		_rescan_widths(str);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_update_n_values(cobj_string_t *str)
+{
+	rope_stats_t stats;
+
+	/* ropes keep their metadata up to date in their nodes, so it is only read back, in O(1) */
+
+	if (str->rope)
+	{
+		stats = rope_get_stats(str->rope);
+
+		str->n_bytes      = stats.n_bytes + 1;
+		str->n_codepoints = stats.n_codepoints;
+		str->n_rows       = stats.n_newlines + 1;
+		str->n_cols       = stats.widest;
+
+		str->cache->flat_valid = false;
+		_free_spans(str->cache);
+
+		return;
+	}
+
+	str->n_bytes = strlen(str->chars) + 1;
+
+	str->n_codepoints = utf8_count(str->chars, str->n_bytes - 1, &str->n_rows);
+
+	str->n_rows += 1;
+
+	_invalidate(str, 0);
+	_rescan_widths(str);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -24,6 +24,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "safe.h"
 
@@ -31,21 +32,50 @@
 /************************************************************************************************************/
 /************************************************************************************************************/
 
-struct _slot_t
+struct _bucket_t
 {
 	const void *ptr;
-	unsigned long n_ref;
+	size_t value;
 };
 
-typedef struct _slot_t _slot_t;
+typedef struct _bucket_t _bucket_t;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct _map_t
+{
+	_bucket_t *buckets;
+	size_t mask;
+};
+
+typedef struct _map_t _map_t;
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
 struct _tracker_t
 {
-	_slot_t *slots;
+	const void **ptrs;
+	unsigned long *n_refs;
+	cobj_tracker_cursor_t *cursors;
+	_map_t map;
 	size_t n;
 	size_t n_alloc;
+	size_t n_dead;
+	size_t n_mapped;
+	size_t n_keys;
+	size_t iterator;
+	bool deferred;
+	bool mapped;
+	bool failed;
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct _tracker_cursor_t
+{
+	cobj_tracker_t *tracker;
+	cobj_tracker_cursor_t *prev;
+	cobj_tracker_cursor_t *next;
 	size_t iterator;
 	bool failed;
 };
@@ -54,7 +84,14 @@ struct _tracker_t
 /************************************************************************************************************/
 /************************************************************************************************************/
 
-static bool _resize(cobj_tracker_t *tracker, size_t n, size_t a, size_t b);
+static void       _bury       (cobj_tracker_t *tracker, size_t index);
+static void       _compact    (cobj_tracker_t *tracker);
+static void       _fix_offset (const cobj_tracker_t *tracker, size_t *iterator);
+static bool       _index      (cobj_tracker_t *tracker, size_t n);
+static bool       _map_create (cobj_tracker_t *tracker, _map_t *map, size_t n);
+static _bucket_t *_map_find   (const _map_t *map, const void *ptr);
+static bool       _reserve    (cobj_tracker_t *tracker, size_t n);
+static bool       _resize     (cobj_tracker_t *tracker, size_t n, size_t a, size_t b);
 
 /************************************************************************************************************/
 /************************************************************************************************************/
@@ -62,11 +99,30 @@ static bool _resize(cobj_tracker_t *tracker, size_t n, size_t a, size_t b);
 
 static cobj_tracker_t _err_tracker = 
 {
-	.slots    = NULL,
+	.ptrs     = NULL,
+	.n_refs   = NULL,
+	.cursors  = NULL,
+	.map      = {.buckets = NULL, .mask = 0},
 	.n        = 0,
 	.n_alloc  = 0,
+	.n_dead   = 0,
+	.n_mapped = 0,
+	.n_keys   = 0,
+	.iterator = SIZE_MAX,
+	.deferred = false,
+	.mapped   = false,
+	.failed   = true,
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static cobj_tracker_cursor_t _err_cursor =
+{
+	.tracker  = NULL,
+	.prev     = NULL,
+	.next     = NULL,
 	.iterator = SIZE_MAX,
-	.failed   = false,
+	.failed   = true,
 };
 
 /************************************************************************************************************/
@@ -83,7 +139,29 @@ cobj_tracker_clear(cobj_tracker_t *tracker)
 		return;
 	}
 
-	tracker->n = 0;
+	tracker->n        = 0;
+	tracker->n_dead   = 0;
+	tracker->mapped   = false;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_tracker_compact(cobj_tracker_t *tracker)
+{
+	assert(tracker);
+
+	if (tracker->failed)
+	{
+		return;
+	}
+
+	if (tracker->n_dead == 0)
+	{
+		return;
+	}
+
+	_compact(tracker);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -98,10 +176,18 @@ cobj_tracker_create(size_t n_alloc)
 		return &_err_tracker;
 	}
 
-	tracker->slots    = NULL;
+	tracker->ptrs     = NULL;
+	tracker->n_refs   = NULL;
+	tracker->cursors  = NULL;
+	tracker->map      = (_map_t){.buckets = NULL, .mask = 0};
 	tracker->n        = 0;
 	tracker->n_alloc  = 0;
+	tracker->n_dead   = 0;
+	tracker->n_mapped = 0;
+	tracker->n_keys   = 0;
 	tracker->iterator = SIZE_MAX;
+	tracker->deferred = false;
+	tracker->mapped   = false;
 	tracker->failed   = false;
 
 	_resize(tracker, n_alloc, 1, 0);
@@ -111,9 +197,218 @@ cobj_tracker_create(size_t n_alloc)
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
+cobj_tracker_cursor_t *
+cobj_tracker_cursor_create(cobj_tracker_t *tracker)
+{
+	cobj_tracker_cursor_t *cursor;
+
+	assert(tracker);
+
+	if (tracker->failed)
+	{
+		return &_err_cursor;
+	}
+
+	if (!(cursor = malloc(sizeof(cobj_tracker_cursor_t))))
+	{
+		return &_err_cursor;
+	}
+
+	cursor->tracker  = tracker;
+	cursor->prev     = NULL;
+	cursor->next     = tracker->cursors;
+	cursor->iterator = SIZE_MAX;
+	cursor->failed   = false;
+
+	if (tracker->cursors)
+	{
+		tracker->cursors->prev = cursor;
+	}
+
+	tracker->cursors = cursor;
+
+	return cursor;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_tracker_cursor_destroy(cobj_tracker_cursor_t **cursor)
+{
+	assert(cursor && *cursor);
+
+	if (*cursor == &_err_cursor)
+	{
+		return;
+	}
+
+	/* unlink from the tracker, unless it has already been destroyed */
+
+	if (!(*cursor)->failed)
+	{
+		if ((*cursor)->prev)
+		{
+			(*cursor)->prev->next = (*cursor)->next;
+		}
+		else
+		{
+			(*cursor)->tracker->cursors = (*cursor)->next;
+		}
+
+		if ((*cursor)->next)
+		{
+			(*cursor)->next->prev = (*cursor)->prev;
+		}
+	}
+
+	free(*cursor);
+
+	*cursor = &_err_cursor;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+const void *
+cobj_tracker_cursor_get_iteration(const cobj_tracker_cursor_t *cursor)
+{
+	assert(cursor);
+
+	if (cursor->failed || cursor->tracker->failed)
+	{
+		return NULL;
+	}
+
+	if (cursor->iterator == 0 || cursor->iterator > cursor->tracker->n)
+	{
+		return NULL;
+	}
+
+	return cursor->tracker->ptrs[cursor->iterator - 1];
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+unsigned long
+cobj_tracker_cursor_get_iteration_n_ref(const cobj_tracker_cursor_t *cursor)
+{
+	assert(cursor);
+
+	if (cursor->failed || cursor->tracker->failed)
+	{
+		return 0;
+	}
+
+	if (cursor->iterator == 0 || cursor->iterator > cursor->tracker->n)
+	{
+		return 0;
+	}
+
+	return cursor->tracker->n_refs[cursor->iterator - 1];
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+cobj_tracker_cursor_get_offset(const cobj_tracker_cursor_t *cursor)
+{
+	assert(cursor);
+
+	if (cursor->failed || cursor->tracker->failed)
+	{
+		return 0;
+	}
+
+	if (cursor->iterator > cursor->tracker->n)
+	{
+		return 0;
+	}
+
+	return cursor->iterator;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cobj_tracker_cursor_t *
+cobj_tracker_cursor_get_placeholder(void)
+{
+	return &_err_cursor;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+cobj_tracker_cursor_has_failed(const cobj_tracker_cursor_t *cursor)
+{
+	assert(cursor);
+
+	return cursor->failed;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+cobj_tracker_cursor_increment(cobj_tracker_cursor_t *cursor)
+{
+	assert(cursor);
+
+	if (cursor->failed || cursor->tracker->failed)
+	{
+		return false;
+	}
+
+	/* skip slots pulled in deferred mode */
+
+	do
+	{
+		if (cursor->iterator >= cursor->tracker->n)
+		{
+			return false;
+		}
+		cursor->iterator++;
+	}
+	while (cursor->tracker->n_refs[cursor->iterator - 1] == 0);
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_tracker_cursor_lock(cobj_tracker_cursor_t *cursor)
+{
+	assert(cursor);
+
+	if (cursor->failed)
+	{
+		return;
+	}
+
+	cursor->iterator = SIZE_MAX;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_tracker_cursor_reset(cobj_tracker_cursor_t *cursor)
+{
+	assert(cursor);
+
+	if (cursor->failed)
+	{
+		return;
+	}
+
+	cursor->iterator = 0;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
 void
 cobj_tracker_destroy(cobj_tracker_t **tracker)
 {
+	cobj_tracker_cursor_t *cursor;
+	cobj_tracker_cursor_t *next;
+
 	assert(tracker && *tracker);
 
 	if (*tracker == &_err_tracker)
@@ -121,7 +416,20 @@ cobj_tracker_destroy(cobj_tracker_t **tracker)
 		return;
 	}
 
-	free((*tracker)->slots);
+	/* detach remaining cursors, they stay safe to use and destroy but are put in a failed state */
+
+	for (cursor = (*tracker)->cursors; cursor; cursor = next)
+	{
+		next = cursor->next;
+		cursor->tracker = &_err_tracker;
+		cursor->prev    = NULL;
+		cursor->next    = NULL;
+		cursor->failed  = true;
+	}
+
+	free((*tracker)->map.buckets);
+	free((*tracker)->ptrs);
+	free((*tracker)->n_refs);
 	free(*tracker);
 
 	*tracker = &_err_tracker;
@@ -154,7 +462,7 @@ cobj_tracker_find(const cobj_tracker_t *tracker, const void *ptr, size_t *index)
 	i = i0;
 	do
 	{
-		if (tracker->slots[i].ptr == ptr)
+		if (tracker->ptrs[i] == ptr)
 		{
 			goto found;
 		}
@@ -166,7 +474,7 @@ cobj_tracker_find(const cobj_tracker_t *tracker, const void *ptr, size_t *index)
 	i = i0;
 	while (++i < tracker->n)
 	{
-		if (tracker->slots[i].ptr == ptr)
+		if (tracker->ptrs[i] == ptr)
 		{
 			goto found;
 		}
@@ -183,7 +491,7 @@ found:
 		*index = i;
 	}
 
-	return tracker->slots[i].n_ref;
+	return tracker->n_refs[i];
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -218,7 +526,7 @@ cobj_tracker_get_index(const cobj_tracker_t *tracker, size_t index)
 		return NULL;
 	}
 
-	return tracker->slots[index].ptr;
+	return tracker->ptrs[index];
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -238,7 +546,7 @@ cobj_tracker_get_index_n_ref(const cobj_tracker_t *tracker, size_t index)
 		return 0;
 	}
 
-	return tracker->slots[index].n_ref;
+	return tracker->n_refs[index];
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -258,7 +566,7 @@ cobj_tracker_get_iteration(const cobj_tracker_t *tracker)
 		return NULL;
 	}
 
-	return tracker->slots[tracker->iterator - 1].ptr;
+	return tracker->ptrs[tracker->iterator - 1];
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -278,7 +586,7 @@ cobj_tracker_get_iteration_n_ref(const cobj_tracker_t *tracker)
 		return 0;
 	}
 
-	return tracker->slots[tracker->iterator - 1].n_ref;
+	return tracker->n_refs[tracker->iterator - 1];
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -302,6 +610,30 @@ cobj_tracker_get_iterator_offset(const cobj_tracker_t *tracker)
 }
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
+const unsigned long *
+cobj_tracker_get_n_refs(const cobj_tracker_t *tracker, size_t index, size_t *n)
+{
+	assert(tracker && n);
+
+	*n = 0;
+
+	if (tracker->failed)
+	{
+		return NULL;
+	}
+
+	if (index >= tracker->n)
+	{
+		return NULL;
+	}
+
+	*n = tracker->n - index;
+
+	return tracker->n_refs + index;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
 cobj_tracker_t *
 cobj_tracker_get_placeholder(void)
 {
@@ -310,6 +642,30 @@ cobj_tracker_get_placeholder(void)
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
+const void *const *
+cobj_tracker_get_pointers(const cobj_tracker_t *tracker, size_t index, size_t *n)
+{
+	assert(tracker && n);
+
+	*n = 0;
+
+	if (tracker->failed)
+	{
+		return NULL;
+	}
+
+	if (index >= tracker->n)
+	{
+		return NULL;
+	}
+
+	*n = tracker->n - index;
+
+	return tracker->ptrs + index;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
 size_t
 cobj_tracker_get_size(const cobj_tracker_t *tracker)
 {
@@ -345,67 +701,212 @@ cobj_tracker_increment_iterator(cobj_tracker_t *tracker)
 		return false;
 	}
 
-	if (tracker->iterator >= tracker->n)
+	/* skip slots pulled in deferred mode */
+
+	do
 	{
-		return false;
+		if (tracker->iterator >= tracker->n)
+		{
+			return false;
+		}
+		tracker->iterator++;
 	}
-
-	tracker->iterator++;
+	while (tracker->n_refs[tracker->iterator - 1] == 0);
 
 	return true;
 }
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
 void
-cobj_tracker_lock_iterator(cobj_tracker_t *tracker)
+cobj_tracker_intersect(cobj_tracker_t *tracker, const cobj_tracker_t *tracker_src)
 {
-	assert(tracker);
+	_map_t map;
 
-	if (tracker->failed)
+	assert(tracker && tracker_src);
+
+	if (tracker->failed || tracker_src->failed)
 	{
 		return;
 	}
 
-	tracker->iterator = SIZE_MAX;
-}
-
-/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
-
-void
-cobj_tracker_pull_index(cobj_tracker_t *tracker, size_t index)
-{
-	assert(tracker);
-
-	if (tracker->failed)
+	if (tracker == tracker_src)
 	{
 		return;
 	}
 
-	if (index >= tracker->n)
+	/* index the source pointers, then drop every slot that is not part of them */
+
+	if (!_map_create(tracker, &map, tracker_src->n))
 	{
 		return;
 	}
 
-	if (tracker->slots[index].n_ref-- > 1)
+	for (size_t i = 0; i < tracker_src->n; i++)
 	{
-		return;
+		_map_find(&map, tracker_src->ptrs[i])->ptr = tracker_src->ptrs[i];
 	}
 
-	if (index < tracker->iterator)
-	{	
-		tracker->iterator--;
+	for (size_t i = 0; i < tracker->n; i++)
+	{
+		if (tracker->n_refs[i] > 0 && !_map_find(&map, tracker->ptrs[i])->ptr)
+		{
+			_bury(tracker, i);
+		}
 	}
 
-	for (tracker->n--; index < tracker->n; index++)
+	free(map.buckets);
+
+	if (!tracker->deferred)
 	{
-		tracker->slots[index] = tracker->slots[index + 1];
+		_compact(tracker);
 	}
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
 void
-cobj_tracker_pull_pointer(cobj_tracker_t *tracker, const void *ptr, size_t index)
+cobj_tracker_lock_iterator(cobj_tracker_t *tracker)
+{
+	assert(tracker);
+
+	if (tracker->failed)
+	{
+		return;
+	}
+
+	tracker->iterator = SIZE_MAX;
+
+	if (tracker->n_dead > 0)
+	{
+		_compact(tracker);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_tracker_pull_index(cobj_tracker_t *tracker, size_t index)
+{
+	cobj_tracker_cursor_t *cursor;
+
+	assert(tracker);
+
+	if (tracker->failed)
+	{
+		return;
+	}
+
+	if (index >= tracker->n || tracker->n_refs[index] == 0)
+	{
+		return;
+	}
+
+	if (tracker->n_refs[index] > 1)
+	{
+		tracker->n_refs[index]--;
+		return;
+	}
+
+	/* in deferred mode, only mark the slot as dead, it will get removed on the next compaction */
+
+	if (tracker->deferred)
+	{
+		_bury(tracker, index);
+		return;
+	}
+
+	if (index < tracker->iterator)
+	{	
+		tracker->iterator--;
+	}
+
+	for (cursor = tracker->cursors; cursor; cursor = cursor->next)
+	{
+		if (index < cursor->iterator)
+		{
+			cursor->iterator--;
+		}
+	}
+
+	/* slots after the removed one move, so the pointer map no longer matches them */
+
+	tracker->mapped = false;
+
+	for (tracker->n--; index < tracker->n; index++)
+	{
+		tracker->ptrs[index]   = tracker->ptrs[index + 1];
+		tracker->n_refs[index] = tracker->n_refs[index + 1];
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_tracker_pull_many(cobj_tracker_t *tracker, const void *const *ptrs, size_t n)
+{
+	_map_t map;
+	_bucket_t *bucket;
+
+	assert(tracker);
+
+	if (tracker->failed)
+	{
+		return;
+	}
+
+	if (!ptrs || n == 0 || tracker->n == 0)
+	{
+		return;
+	}
+
+	/* count how many times each pointer has to be pulled */
+
+	if (!_map_create(tracker, &map, n))
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < n; i++)
+	{
+		if (ptrs[i])
+		{
+			bucket = _map_find(&map, ptrs[i]);
+			bucket->ptr = ptrs[i];
+			bucket->value++;
+		}
+	}
+
+	/* decrement reference counters, then remove unreferenced slots in a single pass */
+
+	for (size_t i = 0; i < tracker->n; i++)
+	{
+		if (tracker->n_refs[i] == 0 || !(bucket = _map_find(&map, tracker->ptrs[i]))->ptr)
+		{
+			continue;
+		}
+
+		if (bucket->value < tracker->n_refs[i])
+		{
+			tracker->n_refs[i] -= bucket->value;
+		}
+		else
+		{
+			_bury(tracker, i);
+		}
+	}
+
+	free(map.buckets);
+
+	if (!tracker->deferred)
+	{
+		_compact(tracker);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_tracker_pull_pointer(cobj_tracker_t *tracker, const void *ptr, size_t index)
 {
 	assert(tracker);
 
@@ -443,9 +944,9 @@ cobj_tracker_push(cobj_tracker_t *tracker, const void *ptr, size_t *index)
 
 	if (cobj_tracker_find(tracker, ptr, index) > 0)
 	{
-		if (tracker->slots[*index].n_ref < ULONG_MAX)
+		if (tracker->n_refs[*index] < ULONG_MAX)
 		{
-			tracker->slots[*index].n_ref++;
+			tracker->n_refs[*index]++;
 		}
 		return;
 	}
@@ -462,13 +963,83 @@ cobj_tracker_push(cobj_tracker_t *tracker, const void *ptr, size_t *index)
 		*index = tracker->n;
 	}
 
-	tracker->slots[tracker->n].ptr   = ptr;
-	tracker->slots[tracker->n].n_ref = 1;
+	tracker->ptrs[tracker->n]   = ptr;
+	tracker->n_refs[tracker->n] = 1;
 	tracker->n++;
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
+void
+cobj_tracker_push_many(cobj_tracker_t *tracker, const void *const *ptrs, size_t n)
+{
+	_bucket_t *bucket;
+
+	size_t n_total;
+
+	assert(tracker);
+
+	if (tracker->failed)
+	{
+		return;
+	}
+
+	if (!ptrs || n == 0)
+	{
+		return;
+	}
+
+	/* reserve enough slots for the worst case, where all pointers are new */
+
+	if (!safe_add(&n_total, tracker->n, n))
+	{
+		tracker->failed = true;
+		return;
+	}
+
+	if (!_reserve(tracker, n_total) || !_index(tracker, n))
+	{
+		return;
+	}
+
+	/* reference already tracked pointers, then append the new ones */
+
+	for (size_t i = 0; i < n; i++)
+	{
+		if (!ptrs[i])
+		{
+			continue;
+		}
+
+		bucket = _map_find(&tracker->map, ptrs[i]);
+
+		if (bucket->ptr && tracker->ptrs[bucket->value] == ptrs[i])
+		{
+			if (tracker->n_refs[bucket->value] < ULONG_MAX)
+			{
+				tracker->n_refs[bucket->value]++;
+			}
+			continue;
+		}
+
+		if (!bucket->ptr)
+		{
+			tracker->n_keys++;
+		}
+
+		bucket->ptr   = ptrs[i];
+		bucket->value = tracker->n;
+
+		tracker->ptrs[tracker->n]   = ptrs[i];
+		tracker->n_refs[tracker->n] = 1;
+		tracker->n++;
+	}
+
+	tracker->n_mapped = tracker->n;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
 void
 cobj_tracker_reset_iterator(cobj_tracker_t *tracker)
 {
@@ -484,6 +1055,73 @@ cobj_tracker_reset_iterator(cobj_tracker_t *tracker)
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
+void
+cobj_tracker_set_pull_mode(cobj_tracker_t *tracker, cobj_tracker_pull_mode_t pull_mode)
+{
+	assert(tracker);
+
+	if (tracker->failed)
+	{
+		return;
+	}
+
+	tracker->deferred = pull_mode == COBJ_TRACKER_PULL_DEFERRED;
+
+	if (!tracker->deferred && tracker->n_dead > 0)
+	{
+		_compact(tracker);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_tracker_subtract(cobj_tracker_t *tracker, const cobj_tracker_t *tracker_src)
+{
+	_map_t map;
+
+	assert(tracker && tracker_src);
+
+	if (tracker->failed || tracker_src->failed)
+	{
+		return;
+	}
+
+	if (tracker->n == 0 || tracker_src->n == 0)
+	{
+		return;
+	}
+
+	/* index the source pointers, then drop every slot that is part of them */
+
+	if (!_map_create(tracker, &map, tracker_src->n))
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < tracker_src->n; i++)
+	{
+		_map_find(&map, tracker_src->ptrs[i])->ptr = tracker_src->ptrs[i];
+	}
+
+	for (size_t i = 0; i < tracker->n; i++)
+	{
+		if (tracker->n_refs[i] > 0 && _map_find(&map, tracker->ptrs[i])->ptr)
+		{
+			_bury(tracker, i);
+		}
+	}
+
+	free(map.buckets);
+
+	if (!tracker->deferred)
+	{
+		_compact(tracker);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
 void
 cobj_tracker_trim(cobj_tracker_t *tracker)
 {
@@ -494,25 +1132,314 @@ cobj_tracker_trim(cobj_tracker_t *tracker)
 		return;
 	}
 
+	/* the pointer map is only a cache, it gets rebuilt on the next batch push */
+
+	free(tracker->map.buckets);
+	tracker->map    = (_map_t){.buckets = NULL, .mask = 0};
+	tracker->mapped = false;
+
 	_resize(tracker, tracker->n, 1, 0);
 }
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cobj_tracker_unite(cobj_tracker_t *tracker, const cobj_tracker_t *tracker_src)
+{
+	_bucket_t *bucket;
+
+	size_t n_src;
+	size_t n_total;
+
+	assert(tracker && tracker_src);
+
+	if (tracker->failed || tracker_src->failed)
+	{
+		return;
+	}
+
+	if (tracker == tracker_src || tracker_src->n == 0)
+	{
+		return;
+	}
+
+	n_src = tracker_src->n;
+
+	/* reserve enough slots for the worst case, where all source pointers are new */
+
+	if (!safe_add(&n_total, tracker->n, n_src))
+	{
+		tracker->failed = true;
+		return;
+	}
+
+	if (!_reserve(tracker, n_total) || !_index(tracker, n_src))
+	{
+		return;
+	}
+
+	/* append the missing pointers with their reference counter */
+
+	for (size_t i = 0; i < n_src; i++)
+	{
+		if (tracker_src->n_refs[i] == 0)
+		{
+			continue;
+		}
+
+		bucket = _map_find(&tracker->map, tracker_src->ptrs[i]);
+
+		if (bucket->ptr && tracker->ptrs[bucket->value] == tracker_src->ptrs[i])
+		{
+			continue;
+		}
+
+		if (!bucket->ptr)
+		{
+			tracker->n_keys++;
+		}
+
+		bucket->ptr   = tracker_src->ptrs[i];
+		bucket->value = tracker->n;
+
+		tracker->ptrs[tracker->n]   = tracker_src->ptrs[i];
+		tracker->n_refs[tracker->n] = tracker_src->n_refs[i];
+		tracker->n++;
+	}
+
+	tracker->n_mapped = tracker->n;
+}
+
 /************************************************************************************************************/
 /* _ ********************************************************************************************************/
 /************************************************************************************************************/
 
+static void
+_bury(cobj_tracker_t *tracker, size_t index)
+{
+	tracker->ptrs[index]   = NULL;
+	tracker->n_refs[index] = 0;
+	tracker->n_dead++;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_compact(cobj_tracker_t *tracker)
+{
+	cobj_tracker_cursor_t *cursor;
+
+	size_t j = 0;
+
+	/* adjust iterators first, they need to know where the removed slots were */
+
+	_fix_offset(tracker, &tracker->iterator);
+
+	for (cursor = tracker->cursors; cursor; cursor = cursor->next)
+	{
+		_fix_offset(tracker, &cursor->iterator);
+	}
+
+	/* move remaining slots in a single pass */
+
+	for (size_t i = 0; i < tracker->n; i++)
+	{
+		if (tracker->n_refs[i] > 0)
+		{
+			tracker->ptrs[j]   = tracker->ptrs[i];
+			tracker->n_refs[j] = tracker->n_refs[i];
+			j++;
+		}
+	}
+
+	tracker->n      = j;
+	tracker->n_dead = 0;
+	tracker->mapped = false;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_fix_offset(const cobj_tracker_t *tracker, size_t *iterator)
+{
+	size_t n = 0;
+
+	if (*iterator > tracker->n)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < *iterator; i++)
+	{
+		if (tracker->n_refs[i] == 0)
+		{
+			n++;
+		}
+	}
+
+	*iterator -= n;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_index(cobj_tracker_t *tracker, size_t n)
+{
+	_bucket_t *bucket;
+
+	size_t n_keys;
+
+	/* the pointer map persists across batch pushes, keys of slots that got buried stay in it but no */
+	/* longer match their slot, reset it when slots have moved or when n more keys would overload it, */
+	/* n_mapped is only meaningful while the map is valid */
+
+	if (!tracker->mapped
+	 || !tracker->map.buckets
+	 || !safe_add(&n_keys, tracker->n_keys, tracker->n - tracker->n_mapped)
+	 || !safe_add(&n_keys, n_keys, n)
+	 || n_keys > tracker->map.mask / 2)
+	{
+		if (!safe_add(&n_keys, tracker->n, n) || !safe_mul(&n_keys, n_keys, 2))
+		{
+			tracker->failed = true;
+			return false;
+		}
+
+		tracker->n_mapped = 0;
+		tracker->n_keys   = 0;
+
+		/* a map that is still large enough is wiped rather than reallocated */
+
+		if (tracker->map.buckets && n_keys <= tracker->map.mask / 2)
+		{
+			memset(tracker->map.buckets, 0, (tracker->map.mask + 1) * sizeof(_bucket_t));
+		}
+		else
+		{
+			free(tracker->map.buckets);
+			tracker->map.buckets = NULL;
+
+			if (!_map_create(tracker, &tracker->map, n_keys))
+			{
+				return false;
+			}
+		}
+
+		tracker->mapped = true;
+	}
+
+	/* catch up with slots appended since the last batch */
+
+	for (size_t i = tracker->n_mapped; i < tracker->n; i++)
+	{
+		if (tracker->n_refs[i] == 0)
+		{
+			continue;
+		}
+
+		bucket = _map_find(&tracker->map, tracker->ptrs[i]);
+
+		if (!bucket->ptr)
+		{
+			tracker->n_keys++;
+		}
+
+		bucket->ptr   = tracker->ptrs[i];
+		bucket->value = i;
+	}
+
+	tracker->n_mapped = tracker->n;
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_map_create(cobj_tracker_t *tracker, _map_t *map, size_t n)
+{
+	size_t n_buckets = 16;
+
+	/* power of 2 bucket count with a max load of 0.5 */
+
+	while (n_buckets / 2 < n)
+	{
+		if (!safe_mul(&n_buckets, n_buckets, 2))
+		{
+			tracker->failed = true;
+			return false;
+		}
+	}
+
+	if (!(map->buckets = calloc(n_buckets, sizeof(_bucket_t))))
+	{
+		tracker->failed = true;
+		return false;
+	}
+
+	map->mask = n_buckets - 1;
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static _bucket_t *
+_map_find(const _map_t *map, const void *ptr)
+{
+	uint64_t h;
+	size_t   i;
+
+	/* fibonacci hashing, low pointer bits are mostly 0 because of alignment */
+
+	h = (uint64_t)(uintptr_t)ptr * 11400714819323198485ULL;
+	i = (size_t)(h >> 32) & map->mask;
+
+	while (map->buckets[i].ptr && map->buckets[i].ptr != ptr)
+	{
+		i = (i + 1) & map->mask;
+	}
+
+	return map->buckets + i;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+_reserve(cobj_tracker_t *tracker, size_t n)
+{
+	if (n <= tracker->n_alloc)
+	{
+		return true;
+	}
+
+	/* grow geometrically, so that repeated batches stay amortized O(1) per pointer */
+
+	if (n / 2 < tracker->n_alloc && !safe_mul(&n, tracker->n_alloc, 2))
+	{
+		tracker->failed = true;
+		return false;
+	}
+
+	return _resize(tracker, n, 1, 0);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
 static bool
 _resize(cobj_tracker_t *tracker, size_t n, size_t a, size_t b)
 {
-	_slot_t *tmp;
-	
+	const void **tmp_1;
+	unsigned long *tmp_2;
+
 	bool safe = true;
 
 	/* test for overflow */
 
 	safe &= safe_mul(&n,   n, a);
 	safe &= safe_add(&n,   n, b);
-	safe &= safe_mul(NULL, n, sizeof(_slot_t));
+	safe &= safe_mul(NULL, n, sizeof(void*));
+	safe &= safe_mul(NULL, n, sizeof(unsigned long));
 
 	if (!safe)
 	{
@@ -520,23 +1447,32 @@ _resize(cobj_tracker_t *tracker, size_t n, size_t a, size_t b)
 		return false;
 	}
 
-	/* resize array */
+	/* resize arrays */
 
 	if (n == 0)
 	{
-		free(tracker->slots);
-		tmp = NULL;
+		free(tracker->ptrs);
+		free(tracker->n_refs);
+		tracker->ptrs   = NULL;
+		tracker->n_refs = NULL;
 	}
 	else
 	{
-		if (!(tmp = realloc(tracker->slots, n * sizeof(_slot_t))))
+		if (!(tmp_1 = realloc(tracker->ptrs, n * sizeof(void*))))
+		{
+			tracker->failed = true;
+			return false;
+		}
+		tracker->ptrs = tmp_1;
+
+		if (!(tmp_2 = realloc(tracker->n_refs, n * sizeof(unsigned long))))
 		{
 			tracker->failed = true;
 			return false;
 		}
+		tracker->n_refs = tmp_2;
 	}
 
-	tracker->slots   = tmp;
 	tracker->n_alloc = n;
 
 	return true;
@@ -0,0 +1,285 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+#elif defined(__SSE2__)
+	#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+	#include <arm_neon.h>
+#endif
+
+#include "scan.h"
+#include "utf8.h"
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static void     _classify        (const char *chars, size_t n, uint64_t *leads, uint64_t *rows);
+static void     _classify_scalar (const char *chars, size_t n, uint64_t *leads, uint64_t *rows);
+static size_t   _popcount        (uint64_t mask);
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(__ARM_NEON)
+static void     _classify_simd   (const char *chars, uint64_t *leads, uint64_t *rows);
+#endif
+
+#if !defined(__AVX2__) && !defined(__SSE2__) && defined(__ARM_NEON)
+static uint64_t _movemask        (uint8x16_t v);
+#endif
+
+/************************************************************************************************************/
+/* PRIVATE **************************************************************************************************/
+/************************************************************************************************************/
+
+size_t
+utf8_count(const char *chars, size_t n, size_t *n_rows)
+{
+	uint64_t leads;
+	uint64_t rows;
+	size_t   n_codepoints = 0;
+	size_t   m;
+
+	/* codepoints are counted by their lead byte, so any byte that is not a continuation byte (10xxxxxx) */
+
+	if (n_rows)
+	{
+		*n_rows = 0;
+	}
+
+	for (size_t i = 0; i < n; i += UTF8_BLOCK)
+	{
+		m = n - i < UTF8_BLOCK ? n - i : UTF8_BLOCK;
+
+		_classify(chars + i, m, &leads, n_rows ? &rows : NULL);
+
+		n_codepoints += _popcount(leads);
+		if (n_rows)
+		{
+			*n_rows += _popcount(rows);
+		}
+	}
+
+	return n_codepoints;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+utf8_seek(const char *chars, size_t n, size_t index)
+{
+	uint64_t leads;
+	size_t   n_leads;
+	size_t   m;
+
+	/* whole blocks are skipped by popcount, then the remaining lead bits are cleared one by one */
+
+	for (size_t i = 0; i < n; i += UTF8_BLOCK)
+	{
+		m = n - i < UTF8_BLOCK ? n - i : UTF8_BLOCK;
+
+		_classify(chars + i, m, &leads, NULL);
+
+		if ((n_leads = _popcount(leads)) <= index)
+		{
+			index -= n_leads;
+			continue;
+		}
+
+		for (; index > 0; index--)
+		{
+			leads &= leads - 1;
+		}
+
+		return i + scan_ctz(leads);
+	}
+
+	return n;
+}
+
+/************************************************************************************************************/
+/* _ ********************************************************************************************************/
+/************************************************************************************************************/
+
+static void
+_classify(const char *chars, size_t n, uint64_t *leads, uint64_t *rows)
+{
+#if defined(__AVX2__) || defined(__SSE2__) || defined(__ARM_NEON)
+	if (n == UTF8_BLOCK)
+	{
+		_classify_simd(chars, leads, rows);
+		return;
+	}
+#endif
+
+	_classify_scalar(chars, n, leads, rows);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+_classify_scalar(const char *chars, size_t n, uint64_t *leads, uint64_t *rows)
+{
+	*leads = 0;
+
+	for (size_t i = 0; i < n; i++)
+	{
+		*leads |= (uint64_t)(((uint8_t)chars[i] >> 6) != 0x02) << i;
+	}
+
+	if (!rows)
+	{
+		return;
+	}
+
+	*rows = 0;
+
+	for (size_t i = 0; i < n; i++)
+	{
+		*rows |= (uint64_t)(chars[i] == '\n') << i;
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+#if defined(__AVX2__)
+
+static void
+_classify_simd(const char *chars, uint64_t *leads, uint64_t *rows)
+{
+	__m256i v_1;
+	__m256i v_2;
+	__m256i c;
+	__m256i r;
+
+	v_1 = _mm256_loadu_si256((const __m256i*)chars);
+	v_2 = _mm256_loadu_si256((const __m256i*)(chars + 32));
+
+	/* as signed bytes, continuation bytes are the ones in [-128, -65] */
+
+	c = _mm256_set1_epi8(-65);
+	r = _mm256_set1_epi8('\n');
+
+	*leads = (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(v_1, c))
+	       | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(v_2, c)) << 32;
+
+	if (rows)
+	{
+		*rows = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v_1, r))
+		      | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v_2, r)) << 32;
+	}
+}
+
+#elif defined(__SSE2__)
+
+static void
+_classify_simd(const char *chars, uint64_t *leads, uint64_t *rows)
+{
+	__m128i v;
+	__m128i c;
+	__m128i r;
+
+	/* as signed bytes, continuation bytes are the ones in [-128, -65] */
+
+	c = _mm_set1_epi8(-65);
+	r = _mm_set1_epi8('\n');
+
+	*leads = 0;
+	if (rows)
+	{
+		*rows = 0;
+	}
+
+	for (size_t j = 0; j < 4; j++)
+	{
+		v       = _mm_loadu_si128((const __m128i*)(chars + j * 16));
+		*leads |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpgt_epi8(v, c)) << (j * 16);
+		if (rows)
+		{
+			*rows |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, r)) << (j * 16);
+		}
+	}
+}
+
+#elif defined(__ARM_NEON)
+
+static void
+_classify_simd(const char *chars, uint64_t *leads, uint64_t *rows)
+{
+	int8x16_t v;
+
+	/* as signed bytes, continuation bytes are the ones in [-128, -65] */
+
+	*leads = 0;
+	if (rows)
+	{
+		*rows = 0;
+	}
+
+	for (size_t j = 0; j < 4; j++)
+	{
+		v       = vld1q_s8((const int8_t*)(chars + j * 16));
+		*leads |= _movemask(vcgtq_s8(v, vdupq_n_s8(-65))) << (j * 16);
+		if (rows)
+		{
+			*rows |= _movemask(vceqq_s8(v, vdupq_n_s8('\n'))) << (j * 16);
+		}
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static uint64_t
+_movemask(uint8x16_t v)
+{
+	static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+
+	uint8x8_t p;
+
+	/* NEON has no movemask, so each byte keeps its own bit and bytes are summed pairwise down to 16 bits */
+
+	v = vandq_u8(v, vld1q_u8(weights));
+	p = vpadd_u8(vget_low_u8(v), vget_high_u8(v));
+	p = vpadd_u8(p, p);
+	p = vpadd_u8(p, p);
+
+	return vget_lane_u16(vreinterpret_u16_u8(p), 0);
+}
+
+#endif
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+_popcount(uint64_t mask)
+{
+#if defined(__GNUC__)
+	return __builtin_popcountll(mask);
+#else
+	mask = mask - ((mask >> 1) & 0x5555555555555555);
+	mask = (mask & 0x3333333333333333) + ((mask >> 2) & 0x3333333333333333);
+	mask = (mask + (mask >> 4)) & 0x0F0F0F0F0F0F0F0F;
+
+	return (mask * 0x0101010101010101) >> 56;
+#endif
+}